@@ -0,0 +1,608 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../binary_set.hxx"
+
+// --- Helper Functions for generating test data ---
+
+// Generates a binary_set where each element is present with probability density_percent / 100
+binary_set generate_random_set(unsigned int capacity, unsigned int density_percent, std::mt19937& gen) {
+    std::bernoulli_distribution present(density_percent / 100.0);
+    binary_set bs(capacity);
+    for (unsigned int i = 0; i < capacity; ++i) {
+        if (present(gen)) bs.add(i);
+    }
+    return bs;
+}
+
+// --- Fixtures ---
+
+// Fixture holding a collection of random sets and queries.
+// Arguments: number of stored sets, stored-set density (%), query density (%).
+class SearcherFixture : public benchmark::Fixture {
+   public:
+    static constexpr unsigned int CAPACITY = 128;
+    static constexpr unsigned int QUERY_COUNT = 64;
+
+    void SetUp(const ::benchmark::State& state) override {
+        std::mt19937 gen(42);  // Fixed seed so that every engine sees the same data
+        const auto set_count = static_cast<unsigned int>(state.range(0));
+        const auto stored_density = static_cast<unsigned int>(state.range(1));
+        const auto query_density = static_cast<unsigned int>(state.range(2));
+
+        stored.clear();
+        stored.reserve(set_count);
+        for (unsigned int i = 0; i < set_count; ++i) {
+            stored.push_back(generate_random_set(CAPACITY, stored_density, gen));
+        }
+
+        queries.clear();
+        queries.reserve(QUERY_COUNT);
+        for (unsigned int i = 0; i < QUERY_COUNT; ++i) {
+            queries.push_back(generate_random_set(CAPACITY, query_density, gen));
+        }
+    }
+
+    void TearDown(const ::benchmark::State& state) override {
+        stored.clear();
+        queries.clear();
+    }
+
+   protected:
+    std::vector<binary_set> stored;
+    std::vector<binary_set> queries;
+};
+
+// Runs every query once per iteration and reports queries per second
+template <typename Searcher>
+void run_queries(benchmark::State& state, const Searcher& searcher, const std::vector<binary_set>& queries) {
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            benchmark::DoNotOptimize(searcher.find_subsets(query));
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+
+// Reports the average number of tree nodes visited per query
+void report_visited_nodes(benchmark::State& state, const bs_searcher& searcher, const std::vector<binary_set>& queries) {
+    std::size_t visited = 0;
+    for (const auto& query : queries) visited += searcher.visited_nodes(query);
+    state.counters["nodes/query"] = static_cast<double>(visited) / static_cast<double>(queries.size());
+}
+
+// Reports the memory the searcher holds per stored set
+void report_memory(benchmark::State& state, const bs_searcher& searcher) {
+    state.counters["bytes/set"] = searcher.stats().bytes_per_set;
+}
+
+// Collection sizes x stored-set densities, with half-filled queries
+void searcher_arguments(benchmark::internal::Benchmark* b) {
+    for (int sets : {1 << 10, 1 << 14, 1 << 17}) {
+        for (int density : {2, 5, 10, 25}) {
+            b->Args({sets, density, 50});
+        }
+    }
+}
+
+// --- Benchmarks for find_subsets: tree vs. posting bitmaps ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsTree)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    run_queries(state, searcher, queries);
+    report_visited_nodes(state, searcher, queries);
+    report_memory(state, searcher);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsTree)->Apply(searcher_arguments)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsBitmap)(benchmark::State& state) {
+    bs_bitmap_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    run_queries(state, searcher, queries);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsBitmap)->Apply(searcher_arguments)->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for bitmap output: converting the result vector vs. marking bits directly ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsVectorToBitmap)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    binary_set matches(static_cast<unsigned int>(stored.size()));
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            matches.clear();
+            for (unsigned int id : searcher.find_subsets(query)) matches.add(id);
+            benchmark::DoNotOptimize(matches);
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsVectorToBitmap)->Args({1 << 10, 2, 50})->Args({1 << 14, 2, 50})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsBitmapOutput)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    binary_set matches(static_cast<unsigned int>(stored.size()));
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            matches.clear();
+            searcher.find_subsets_bitmap(query, matches);
+            benchmark::DoNotOptimize(matches);
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+    std::size_t matched = 0;
+    for (const auto& query : queries) matched += searcher.find_subsets(query).size();
+    state.counters["matches/query"] = static_cast<double>(matched) / static_cast<double>(queries.size());
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsBitmapOutput)->Args({1 << 10, 2, 50})->Args({1 << 14, 2, 50})->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for the all-ones suffix: leaf ranges out of order vs. in depth-first order ---
+
+// Half-filled queries whose last suffix_length elements are all present
+std::vector<binary_set> suffix_queries(const std::vector<binary_set>& queries, unsigned int capacity, unsigned int suffix_length) {
+    std::vector<binary_set> result = queries;
+    for (auto& query : result) {
+        for (unsigned int i = capacity - suffix_length; i < capacity; ++i) query.add(i);
+    }
+    return result;
+}
+
+// Arguments: number of stored sets, stored-set density (%), suffix length
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsSuffixAdded)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    run_queries(state, searcher, suffix_queries(queries, CAPACITY, static_cast<unsigned int>(state.range(2))));
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsSuffixAdded)->Args({1 << 14, 5, 32})->Args({1 << 14, 5, 64})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsSuffixBulkLoaded)(benchmark::State& state) {
+    std::vector<std::pair<unsigned int, binary_set>> entries;
+    for (unsigned int i = 0; i < stored.size(); ++i) entries.emplace_back(i, stored[i]);
+    bs_searcher searcher(CAPACITY);
+    searcher.bulk_load(entries);
+    run_queries(state, searcher, suffix_queries(queries, CAPACITY, static_cast<unsigned int>(state.range(2))));
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsSuffixBulkLoaded)->Args({1 << 14, 5, 32})->Args({1 << 14, 5, 64})->Unit(benchmark::kMicrosecond);
+
+// --- Parameterized suite: add, remove and find_subsets vs. a linear scan ---
+
+// Fixture like SearcherFixture, but with the capacity as a parameter too.
+// Arguments: capacity, number of stored sets, stored-set density (%), query density (%).
+class SuiteFixture : public benchmark::Fixture {
+   public:
+    static constexpr unsigned int QUERY_COUNT = 64;
+
+    void SetUp(const ::benchmark::State& state) override {
+        std::mt19937 gen(42);
+        capacity = static_cast<unsigned int>(state.range(0));
+        const auto set_count = static_cast<unsigned int>(state.range(1));
+        const auto stored_density = static_cast<unsigned int>(state.range(2));
+        const auto query_density = static_cast<unsigned int>(state.range(3));
+
+        stored.clear();
+        stored.reserve(set_count);
+        for (unsigned int i = 0; i < set_count; ++i) stored.push_back(generate_random_set(capacity, stored_density, gen));
+
+        queries.clear();
+        queries.reserve(QUERY_COUNT);
+        for (unsigned int i = 0; i < QUERY_COUNT; ++i) queries.push_back(generate_random_set(capacity, query_density, gen));
+    }
+
+    void TearDown(const ::benchmark::State& state) override {
+        stored.clear();
+        queries.clear();
+    }
+
+   protected:
+    unsigned int capacity = 0;
+    std::vector<binary_set> stored;
+    std::vector<binary_set> queries;
+
+    bs_searcher make_searcher() const {
+        bs_searcher searcher(capacity);
+        for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+        return searcher;
+    }
+};
+
+// Capacities x collection sizes x stored-set densities x query densities. The
+// tree keeps one node per level along each path, so the largest collections
+// are only paired with the smaller capacities.
+void suite_arguments(benchmark::internal::Benchmark* b) {
+    for (int capacity : {64, 256, 1024}) {
+        for (int sets : {1 << 10, 1 << 13, 1 << 16}) {
+            if (capacity == 1024 && sets == 1 << 16) continue;
+            for (int stored_density : {5, 25}) {
+                for (int query_density : {50, 90}) {
+                    b->Args({capacity, sets, stored_density, query_density});
+                }
+            }
+        }
+    }
+    b->ArgNames({"capacity", "sets", "stored%", "query%"});
+}
+
+BENCHMARK_DEFINE_F(SuiteFixture, FindSubsetsTree)(benchmark::State& state) {
+    const bs_searcher searcher = make_searcher();
+    run_queries(state, searcher, queries);
+    report_visited_nodes(state, searcher, queries);
+    report_memory(state, searcher);
+}
+BENCHMARK_REGISTER_F(SuiteFixture, FindSubsetsTree)->Apply(suite_arguments)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SuiteFixture, FindSubsetsLinearScan)(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            std::vector<unsigned int> results;
+            for (unsigned int i = 0; i < stored.size(); ++i) {
+                if (query.contains(stored[i])) results.push_back(i);
+            }
+            benchmark::DoNotOptimize(results);
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+    state.counters["bytes/set"] = static_cast<double>(capacity / 8);
+}
+BENCHMARK_REGISTER_F(SuiteFixture, FindSubsetsLinearScan)->Apply(suite_arguments)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SuiteFixture, Add)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(make_searcher());
+    }
+    state.counters["sets/s"] = benchmark::Counter(static_cast<double>(stored.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_REGISTER_F(SuiteFixture, Add)->Apply(suite_arguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(SuiteFixture, Remove)(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        bs_searcher searcher = make_searcher();
+        state.ResumeTiming();
+        for (unsigned int i = 0; i < stored.size(); ++i) searcher.remove(i, stored[i]);
+        benchmark::DoNotOptimize(searcher);
+    }
+    state.counters["sets/s"] = benchmark::Counter(static_cast<double>(stored.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_REGISTER_F(SuiteFixture, Remove)->Apply(suite_arguments)->Unit(benchmark::kMillisecond);
+
+// --- Benchmarks for the sharded searcher ---
+
+// Extra arguments after SearcherFixture's: prefix bits, query threads
+void sharded_arguments(benchmark::internal::Benchmark* b) {
+    for (int prefix_bits : {0, 4, 8}) {
+        for (int threads : {1, 4}) {
+            b->Args({1 << 17, 5, 50, prefix_bits, threads});
+        }
+    }
+}
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsSharded)(benchmark::State& state) {
+    const auto prefix_bits = static_cast<unsigned int>(state.range(3));
+    const auto threads = static_cast<unsigned int>(state.range(4));
+    bs_sharded_searcher searcher(CAPACITY, prefix_bits);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            benchmark::DoNotOptimize(searcher.find_subsets(query, threads));
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+    state.counters["bytes/set"] = static_cast<double>(searcher.memory_usage()) / static_cast<double>(stored.size());
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsSharded)->Apply(sharded_arguments)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for the ZDD family store, on the same data as the tree ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsZdd)(benchmark::State& state) {
+    bs_zdd_family family(CAPACITY);
+    for (const auto& bs : stored) family.add(bs);
+    run_queries(state, family, queries);
+    state.counters["bytes/set"] = static_cast<double>(family.memory_usage()) / static_cast<double>(family.count());
+    state.counters["nodes"] = static_cast<double>(family.node_count());
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsZdd)
+    ->Args({1 << 10, 5, 50})
+    ->Args({1 << 10, 25, 50})
+    ->Args({1 << 14, 5, 50})
+    ->Args({1 << 14, 25, 50})
+    ->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for size-bounded queries: pruned in the tree vs. filtered afterwards ---
+
+constexpr unsigned int MIN_SUBSET_SIZE = 10;
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsMinSizeFiltered)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            std::vector<unsigned int> results = searcher.find_subsets(query);
+            std::erase_if(results, [this](unsigned int id) { return stored[id].size() < MIN_SUBSET_SIZE; });
+            benchmark::DoNotOptimize(results);
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsMinSizeFiltered)->Args({1 << 14, 10, 50})->Args({1 << 17, 10, 50})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsMinSize)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            benchmark::DoNotOptimize(searcher.find_subsets(query, MIN_SUBSET_SIZE, CAPACITY));
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsMinSize)->Args({1 << 14, 10, 50})->Args({1 << 17, 10, 50})->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for intersection queries: tree vs. scanning every set ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindIntersectingScan)(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            std::vector<unsigned int> results;
+            for (unsigned int i = 0; i < stored.size(); ++i) {
+                if (stored[i].intersects(query)) results.push_back(i);
+            }
+            benchmark::DoNotOptimize(results);
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindIntersectingScan)->Args({1 << 14, 2, 2})->Args({1 << 17, 2, 2})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindIntersectingTree)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            benchmark::DoNotOptimize(searcher.find_intersecting(query));
+        }
+    }
+    state.counters["queries/s"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * queries.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindIntersectingTree)->Args({1 << 14, 2, 2})->Args({1 << 17, 2, 2})->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for the query cache: the same queries asked over and over ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, FindSubsetsCached)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    searcher.set_cache_capacity(QUERY_COUNT);
+    for (const auto& query : queries) benchmark::DoNotOptimize(searcher.find_subsets(query));  // Warm up
+    run_queries(state, searcher, queries);
+    state.counters["hit rate"] = static_cast<double>(searcher.cache_hits()) /
+                                 static_cast<double>(searcher.cache_hits() + searcher.cache_misses());
+}
+BENCHMARK_REGISTER_F(SearcherFixture, FindSubsetsCached)->Args({1 << 14, 5, 50})->Args({1 << 17, 5, 50})->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for growing a query one element at a time: re-run vs. live query ---
+
+// Order in which the grown query gains its elements
+std::vector<unsigned int> growth_order(unsigned int capacity) {
+    std::vector<unsigned int> order(capacity);
+    for (unsigned int i = 0; i < capacity; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    return order;
+}
+
+BENCHMARK_DEFINE_F(SearcherFixture, GrowQueryRerun)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    const std::vector<unsigned int> order = growth_order(CAPACITY);
+    for (auto _ : state) {
+        binary_set query(CAPACITY);
+        for (unsigned int element : order) {
+            query.add(element);
+            benchmark::DoNotOptimize(searcher.find_subsets(query));
+        }
+    }
+}
+BENCHMARK_REGISTER_F(SearcherFixture, GrowQueryRerun)->Args({1 << 14, 5, 0})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, GrowQueryLive)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    const std::vector<unsigned int> order = growth_order(CAPACITY);
+    for (auto _ : state) {
+        bs_searcher::live_query live(searcher, binary_set(CAPACITY));
+        for (unsigned int element : order) {
+            live.add_element(element);
+            benchmark::DoNotOptimize(live.results());
+        }
+    }
+}
+BENCHMARK_REGISTER_F(SearcherFixture, GrowQueryLive)->Args({1 << 14, 5, 0})->Unit(benchmark::kMillisecond);
+
+// --- Benchmarks for startup: rebuilding with add() vs. opening a snapshot ---
+
+BENCHMARK_DEFINE_F(SearcherFixture, StartupRebuild)(benchmark::State& state) {
+    for (auto _ : state) {
+        bs_searcher searcher(CAPACITY);
+        for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+        benchmark::DoNotOptimize(searcher);
+    }
+}
+BENCHMARK_REGISTER_F(SearcherFixture, StartupRebuild)->Args({1 << 17, 5, 50})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(SearcherFixture, StartupOpenSnapshot)(benchmark::State& state) {
+    const std::string path = (std::filesystem::temp_directory_path() / "bs_searcher_benchmark.snap").string();
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    searcher.save(path);
+
+    for (auto _ : state) {
+        bs_searcher_view view(path);
+        benchmark::DoNotOptimize(view);
+    }
+    std::remove(path.c_str());
+}
+BENCHMARK_REGISTER_F(SearcherFixture, StartupOpenSnapshot)->Args({1 << 17, 5, 50})->Unit(benchmark::kMillisecond);
+
+// --- Benchmarks for element reordering ---
+
+// Fixture where the discriminating elements sit at high indices: element i is
+// present in stored sets with probability growing with i, and in queries with
+// probability shrinking with i. Arguments: number of stored sets.
+class SkewedSearcherFixture : public benchmark::Fixture {
+   public:
+    static constexpr unsigned int CAPACITY = 64;
+    static constexpr unsigned int QUERY_COUNT = 64;
+
+    void SetUp(const ::benchmark::State& state) override {
+        std::mt19937 gen(42);
+        const auto set_count = static_cast<unsigned int>(state.range(0));
+
+        stored.clear();
+        for (unsigned int i = 0; i < set_count; ++i) stored.push_back(generate_skewed_set(gen, true));
+
+        queries.clear();
+        for (unsigned int i = 0; i < QUERY_COUNT; ++i) queries.push_back(generate_skewed_set(gen, false));
+    }
+
+    void TearDown(const ::benchmark::State& state) override {
+        stored.clear();
+        queries.clear();
+    }
+
+   protected:
+    std::vector<binary_set> stored;
+    std::vector<binary_set> queries;
+
+    static binary_set generate_skewed_set(std::mt19937& gen, bool is_stored) {
+        binary_set bs(CAPACITY);
+        for (unsigned int i = 0; i < CAPACITY; ++i) {
+            const double rank = static_cast<double>(i) / CAPACITY;
+            std::bernoulli_distribution present(is_stored ? 0.15 * rank : 1.0 - rank);
+            if (present(gen)) bs.add(i);
+        }
+        return bs;
+    }
+};
+
+BENCHMARK_DEFINE_F(SkewedSearcherFixture, FindSubsetsIndexOrder)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    run_queries(state, searcher, queries);
+    report_visited_nodes(state, searcher, queries);
+}
+BENCHMARK_REGISTER_F(SkewedSearcherFixture, FindSubsetsIndexOrder)->RangeMultiplier(8)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(SkewedSearcherFixture, FindSubsetsRebuiltOrder)(benchmark::State& state) {
+    bs_searcher searcher(CAPACITY);
+    for (unsigned int i = 0; i < stored.size(); ++i) searcher.add(i, stored[i]);
+    for (const auto& query : queries) searcher.observe_query(query);
+    searcher.rebuild();
+    run_queries(state, searcher, queries);
+    report_visited_nodes(state, searcher, queries);
+}
+BENCHMARK_REGISTER_F(SkewedSearcherFixture, FindSubsetsRebuiltOrder)->RangeMultiplier(8)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMicrosecond);
+
+// --- Benchmarks for bulk loading ---
+
+// Fixture holding (id, set) entries to load into an empty searcher. The
+// capacity is kept small so that a million sets fit in memory twice over.
+// Arguments: number of sets.
+class LoadFixture : public benchmark::Fixture {
+   public:
+    static constexpr unsigned int CAPACITY = 32;
+
+    void SetUp(const ::benchmark::State& state) override {
+        std::mt19937 gen(42);
+        const auto set_count = static_cast<unsigned int>(state.range(0));
+
+        entries.clear();
+        entries.reserve(set_count);
+        for (unsigned int i = 0; i < set_count; ++i) entries.emplace_back(i, generate_random_set(CAPACITY, 20, gen));
+    }
+
+    void TearDown(const ::benchmark::State& state) override { entries.clear(); }
+
+   protected:
+    std::vector<std::pair<unsigned int, binary_set>> entries;
+};
+
+BENCHMARK_DEFINE_F(LoadFixture, AddLoop)(benchmark::State& state) {
+    for (auto _ : state) {
+        bs_searcher searcher(CAPACITY);
+        for (const auto& [id, bs] : entries) searcher.add(id, bs);
+        benchmark::DoNotOptimize(searcher);
+    }
+    state.counters["sets/s"] = benchmark::Counter(static_cast<double>(entries.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_REGISTER_F(LoadFixture, AddLoop)->Arg(1 << 16)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(LoadFixture, BulkLoad)(benchmark::State& state) {
+    for (auto _ : state) {
+        bs_searcher searcher(CAPACITY);
+        searcher.bulk_load(entries);
+        benchmark::DoNotOptimize(searcher);
+    }
+    state.counters["sets/s"] = benchmark::Counter(static_cast<double>(entries.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_REGISTER_F(LoadFixture, BulkLoad)->Arg(1 << 16)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Extra argument: worker threads
+BENCHMARK_DEFINE_F(LoadFixture, AddParallel)(benchmark::State& state) {
+    const auto threads = static_cast<unsigned int>(state.range(1));
+    for (auto _ : state) {
+        bs_searcher searcher(CAPACITY);
+        searcher.add_parallel(entries, threads);
+        benchmark::DoNotOptimize(searcher);
+    }
+    state.counters["sets/s"] = benchmark::Counter(static_cast<double>(entries.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK_REGISTER_F(LoadFixture, AddParallel)
+    ->ArgsProduct({{1 << 16, 1000000}, {1, 2, 4, 8}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// --- Benchmarks for combining searchers: merge() vs. re-adding every set ---
+
+BENCHMARK_DEFINE_F(LoadFixture, MergeReAdd)(benchmark::State& state) {
+    const auto half = entries.begin() + static_cast<std::ptrdiff_t>(entries.size() / 2);
+    for (auto _ : state) {
+        state.PauseTiming();
+        bs_searcher target(CAPACITY);
+        target.bulk_load(std::vector(entries.begin(), half));
+        state.ResumeTiming();
+        for (auto it = half; it != entries.end(); ++it) target.add(it->first, it->second);
+        benchmark::DoNotOptimize(target);
+    }
+}
+BENCHMARK_REGISTER_F(LoadFixture, MergeReAdd)->Arg(1 << 16)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(LoadFixture, Merge)(benchmark::State& state) {
+    const auto half = entries.begin() + static_cast<std::ptrdiff_t>(entries.size() / 2);
+    for (auto _ : state) {
+        state.PauseTiming();
+        bs_searcher target(CAPACITY);
+        target.bulk_load(std::vector(entries.begin(), half));
+        bs_searcher source(CAPACITY);
+        source.bulk_load(std::vector(half, entries.end()));
+        state.ResumeTiming();
+        target.merge(std::move(source));
+        benchmark::DoNotOptimize(target);
+    }
+}
+BENCHMARK_REGISTER_F(LoadFixture, Merge)->Arg(1 << 16)->Arg(1000000)->Unit(benchmark::kMillisecond);
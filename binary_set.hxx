@@ -13,13 +13,40 @@
 #ifndef BINARY_SET_HXX
 #define BINARY_SET_HXX
 
-#include <algorithm>  // std::all_of, std::fill, std::find
-#include <cstddef>    // std::ptrdiff_t, std::size_t
-#include <iterator>   // std::forward_iterator_tag
-#include <memory>     // std::unique_ptr, std::make_unique
-#include <stdexcept>  // std::invalid_argument, std::domain_error, std::out_of_range
-#include <string>     // std::string
-#include <vector>     // std::vector
+#include <algorithm>      // std::all_of, std::fill, std::find
+#include <atomic>         // std::atomic
+#include <bit>            // std::countr_zero, std::popcount, std::endian
+#include <concepts>       // std::equality_comparable, std::convertible_to, std::integral
+#include <cstddef>        // std::ptrdiff_t, std::size_t
+#include <cstdint>        // std::uint64_t
+#include <cstring>        // std::memcpy, std::memcmp
+#include <deque>          // std::deque
+#include <exception>      // std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <fstream>        // std::ofstream, std::ifstream
+#include <functional>     // std::hash
+#include <iterator>       // std::forward_iterator_tag
+#include <limits>         // std::numeric_limits
+#include <mutex>          // std::mutex, std::lock_guard, std::scoped_lock, std::unique_lock
+#include <optional>       // std::optional, std::nullopt
+#include <shared_mutex>   // std::shared_mutex, std::shared_lock
+#include <span>           // std::span
+#include <stdexcept>      // std::invalid_argument, std::domain_error, std::out_of_range, std::runtime_error, std::length_error, std::logic_error
+#include <string>         // std::string
+#include <thread>         // std::thread, std::jthread
+#include <type_traits>    // std::conditional_t, std::is_same_v, std::is_trivially_copyable_v
+#include <unordered_map>  // std::unordered_multimap
+#include <utility>        // std::pair, std::move, std::cmp_less, std::cmp_greater_equal
+#include <vector>         // std::vector
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close
+#define BINARY_SET_HAS_MMAP 1
+#else
+#define BINARY_SET_HAS_MMAP 0
+#endif
 
 /**
  * @brief A space-efficient binary set implementation using bit manipulation.
@@ -445,6 +472,61 @@ class binary_set {
         return true;
     }
 
+    /**
+     * @brief Computes a hash of the set, consistent with operator==.
+     *
+     * Mixes the storage eight bytes at a time.
+     *
+     * @return std::size_t Hash value
+     */
+    [[nodiscard]]
+    std::size_t hash() const noexcept {
+        std::uint64_t h = 0x9E3779B97F4A7C15ull ^ capacity_;
+        for (std::size_t i = 0; i < set_.size(); i += 8) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, set_.data() + i, std::min<std::size_t>(8, set_.size() - i));
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return static_cast<std::size_t>(h);
+    }
+
+    /**
+     * @brief Returns 64 elements of the set as one word, without validation.
+     *
+     * Bit j of word w is element 64 * w + j. Bits past the capacity are 0,
+     * and so are the words past word_count(). Meant for hot loops that check
+     * the capacity once and then decode elements with shifts instead of
+     * calling contains() per element.
+     *
+     * @param index Index of the word
+     * @return std::uint64_t Elements [64 * index, 64 * index + 64)
+     */
+    [[nodiscard]]
+    std::uint64_t word(std::size_t index) const noexcept {
+        const std::size_t first = index * 8;
+        if (first >= set_.size()) return 0;
+
+        const std::size_t count = std::min<std::size_t>(8, set_.size() - first);
+        std::uint64_t result = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(&result, set_.data() + first, count);
+        } else {
+            for (std::size_t b = 0; b < count; ++b) result |= std::uint64_t{set_[first + b]} << (8 * b);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the number of words needed to hold every element.
+     *
+     * @return std::size_t ceil(capacity / 64)
+     */
+    [[nodiscard]]
+    std::size_t word_count() const noexcept {
+        return (static_cast<std::size_t>(capacity_) + 63) / 64;
+    }
+
     /**
      * @brief Returns an iterator to the first element in the set.
      *
@@ -557,6 +639,18 @@ class binary_set {
     }
 };
 
+/**
+ * @brief Hashes binary_sets, so that they can key unordered containers.
+ */
+namespace std {
+template <>
+struct hash<binary_set> {
+    std::size_t operator()(const binary_set &bs) const noexcept {
+        return bs.hash();
+    }
+};
+}  // namespace std
+
 /**
  * @brief Efficiently searches for subsets within a collection of binary sets.
  *
@@ -564,9 +658,48 @@ class binary_set {
  * an element position in the binary_set. This allows efficient lookup of all
  * stored sets that are subsets of a query set.
  *
+ * Levels test elements in index order by default. rebuild() can reorder them
+ * from stored-set and observed query statistics, so that the elements most
+ * likely to prune a query are branched on first.
+ *
+ * Every node keeps a summary of the stored sets below it: the minimum and
+ * maximum number of elements they still hold, and which of the next 64 levels
+ * they all contain or some of them contain. find_subsets() skips a subtree as
+ * soon as the summary shows that no set below it can fit in the rest of the
+ * query; the size-bounded, approximate and overlap queries prune likewise.
+ *
+ * An optional insert mode keeps the stored sets an antichain under inclusion
+ * (only minimal or only maximal sets), as needed by dominance stores such as
+ * nogood databases.
+ *
+ * Nodes live in a single pool and link to their children by index, with freed
+ * nodes recycled. bulk_load() builds a whole tree bottom-up from sorted sets
+ * into contiguous pool storage. The values of all leaves share a second pool,
+ * each leaf owning one range of it; the pool is compacted into depth-first
+ * leaf order once more than half of it is dead, so that the results of a
+ * query are copied out in a few large blocks.
+ *
+ * An optional bounded cache keeps the results of recent find_subsets() calls.
+ * add() drops the cached queries that contain the new set, and removing a set
+ * drops its value from the cached queries containing it, so cached results
+ * are always exact.
+ *
+ * Constructed with index_values, the searcher also maps each value to its
+ * leaf, so that a set can be removed by its identifier alone.
+ *
+ * The payload stored with each set is a template parameter: bs_searcher
+ * stores unsigned int identifiers, but 64-bit IDs or small structs work as
+ * well. Trivially copyable payloads are copied out of the leaves in bulk, and
+ * find_subset_spans() returns views into the leaves without copying at all.
+ * Payloads must be copyable but need no default constructor. The value index
+ * needs payloads that are equality comparable and hashable, and snapshots
+ * are limited to unsigned int payloads.
+ *
  * Time complexity:
  * - add: O(capacity)
  * - remove: O(capacity)
+ * - remove by value (indexed): O(1) amortized, plus O(capacity) when a
+ *   branch is pruned or the query cache is enabled
  * - find_subsets: O(capacity * number_of_matching_paths)
  *
  * Example:
@@ -580,60 +713,281 @@ class binary_set {
  * query.add(1); query.add(3); query.add(5);
  * auto results = searcher.find_subsets(query);  // Returns {101}
  * @endcode
+ *
+ * @tparam Value Payload stored with each set
  */
-class bs_searcher {
+template <typename Value = unsigned int>
+class basic_bs_searcher {
    private:
     struct treenode {
-        std::vector<unsigned int> values;
-        std::unique_ptr<treenode> left;
-        std::unique_ptr<treenode> right;
+        // Leaves: value_count values stored from values_begin in the value
+        // pool, which has room for value_capacity of them there. All 0 for
+        // internal nodes.
+        std::uint32_t values_begin{0};
+        std::uint32_t value_count{0};
+        std::uint32_t value_capacity{0};
+        // Children as indices into the node pool, 0 if absent (the root,
+        // node 0, is never a child)
+        std::uint32_t left{0};
+        std::uint32_t right{0};
+        std::uint32_t parent{0};
+        // Fewest elements any stored set below still holds (right edges to a
+        // leaf). Nodes start out ruling everything out until refreshed.
+        unsigned int min_remaining{std::numeric_limits<unsigned int>::max()};
+        // Most elements any stored set below still holds
+        unsigned int max_remaining{0};
+        // Bit j: every stored set below holds the element tested j levels down
+        std::uint64_t required{~std::uint64_t{0}};
+        // Bit j: some stored set below holds the element tested j levels down
+        std::uint64_t possible{0};
 
         treenode() = default;
     };
 
+    // The words of a set, loaded once so that hot loops test elements with
+    // shifts: callers validate the capacity once instead of paying
+    // contains()'s checks per element
+    class set_words {
+       public:
+        explicit set_words(const binary_set &bs) : words_(bs.word_count()) {
+            for (std::size_t w = 0; w < words_.size(); ++w) words_[w] = bs.word(w);
+        }
+
+        // Whether the set holds element, which must be below its capacity
+        [[nodiscard]]
+        bool holds(unsigned int element) const noexcept {
+            return (words_[element / 64] >> (element % 64)) & 1u;
+        }
+
+       private:
+        std::vector<std::uint64_t> words_;
+    };
+
+    // A query rewritten in level order, with the per-level figures used to
+    // prune subtrees against the node summaries
+    class level_query {
+       public:
+        level_query(const binary_set &bs, const std::vector<unsigned int> &order)
+            : bits_(order.size() / 64 + 2, 0), remaining_(order.size() + 1, 0) {
+            const set_words words(bs);
+            for (std::size_t i = 0; i < order.size(); ++i) {
+                bits_[i / 64] |= std::uint64_t{words.holds(order[i])} << (i % 64);
+            }
+            for (std::size_t i = order.size(); i > 0; --i) {
+                remaining_[i - 1] = remaining_[i] + (present(static_cast<unsigned int>(i - 1)) ? 1 : 0);
+            }
+            // One past the last level whose element is missing from the query
+            ones_from_ = static_cast<unsigned int>(order.size());
+            while (ones_from_ > 0 && present(ones_from_ - 1)) --ones_from_;
+        }
+
+        // Whether the element tested at this level is in the query
+        [[nodiscard]]
+        bool present(unsigned int level) const noexcept {
+            return (bits_[level / 64] >> (level % 64)) & 1u;
+        }
+
+        // Query bits for the 64 levels starting at level
+        [[nodiscard]]
+        std::uint64_t window(unsigned int level) const noexcept {
+            const unsigned int shift = level % 64;
+            const std::uint64_t low = bits_[level / 64] >> shift;
+            return shift == 0 ? low : low | (bits_[level / 64 + 1] << (64 - shift));
+        }
+
+        // Number of query elements tested at this level or below
+        [[nodiscard]]
+        unsigned int remaining(unsigned int level) const noexcept {
+            return remaining_[level];
+        }
+
+        // First level from which the query holds every element tested:
+        // every stored set below a node at this depth or deeper is a subset
+        [[nodiscard]]
+        unsigned int ones_from() const noexcept {
+            return ones_from_;
+        }
+
+        // Whether some stored set below a node at this level may be a subset of the query
+        template <typename Node>
+        [[nodiscard]]
+        bool admits(const Node &node, unsigned int level) const noexcept {
+            return node.min_remaining <= remaining(level) && (node.required & ~window(level)) == 0;
+        }
+
+        // Whether some stored set below a node at this level may hold every
+        // query element tested from this level on (the query as a lower bound)
+        template <typename Node>
+        [[nodiscard]]
+        bool reachable(const Node &node, unsigned int level) const noexcept {
+            return node.max_remaining >= remaining(level) && (window(level) & ~node.possible) == 0;
+        }
+
+        // Lower bound on the elements outside the query that any stored set
+        // below a node at this level holds
+        template <typename Node>
+        [[nodiscard]]
+        unsigned int violations(const Node &node, unsigned int level) const noexcept {
+            const auto missing = static_cast<unsigned int>(std::popcount(node.required & ~window(level)));
+            const unsigned int excess = node.min_remaining > remaining(level) ? node.min_remaining - remaining(level) : 0;
+            return std::max(missing, excess);
+        }
+
+        // Upper bound on the query elements any stored set below a node at
+        // this level holds: the possible ones within the window, plus every
+        // query element past it
+        template <typename Node>
+        [[nodiscard]]
+        unsigned int max_overlap(const Node &node, unsigned int level) const noexcept {
+            const std::size_t past_window = std::min<std::size_t>(level + std::size_t{64}, remaining_.size() - 1);
+            const auto in_window = static_cast<unsigned int>(std::popcount(node.possible & window(level)));
+            return std::min(node.max_remaining, in_window + remaining_[past_window]);
+        }
+
+       private:
+        std::vector<std::uint64_t> bits_;
+        std::vector<unsigned int> remaining_;
+        unsigned int ones_from_;
+    };
+
+    // Snapshot file layout: header, element order, nodes in depth-first order
+    // (child index 0 means no child, since the root is node 0), then values
+    struct snapshot_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t capacity;
+        std::uint64_t node_count;
+        std::uint64_t value_count;
+    };
+
+    struct flat_node {
+        std::uint64_t required;
+        std::uint64_t values_begin;
+        std::uint32_t left;
+        std::uint32_t right;
+        std::uint32_t min_remaining;
+        std::uint32_t value_count;
+    };
+
+    static_assert(sizeof(snapshot_header) == 32 && sizeof(flat_node) == 32, "Unexpected snapshot record padding.");
+    static_assert(sizeof(unsigned int) == sizeof(std::uint32_t), "Snapshots store values as 32-bit integers.");
+
+    static constexpr char SNAPSHOT_MAGIC[8] = {'B', 'S', 'S', 'N', 'A', 'P', '\0', '\0'};
+    static constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+    struct snapshot_layout {
+        std::size_t order_offset;
+        std::size_t nodes_offset;
+        std::size_t values_offset;
+        std::size_t total_size;
+
+        snapshot_layout(std::uint64_t capacity, std::uint64_t node_count, std::uint64_t value_count)
+            : order_offset(sizeof(snapshot_header)),
+              nodes_offset((order_offset + capacity * sizeof(std::uint32_t) + 7) / 8 * 8),
+              values_offset(nodes_offset + node_count * sizeof(flat_node)),
+              total_size(values_offset + value_count * sizeof(std::uint32_t)) {}
+    };
+
+    friend class bs_searcher_view;
+
    public:
+    /**
+     * @brief How add() treats sets related by inclusion to stored ones.
+     */
+    enum class insert_mode {
+        plain,         ///< Store every set
+        keep_minimal,  ///< Refuse sets with a stored subset, evict stored strict supersets
+        keep_maximal   ///< Refuse sets with a stored superset, evict stored strict subsets
+    };
+
+    /**
+     * @brief Shape of the tree, as reported by stats().
+     */
+    struct statistics {
+        std::size_t node_count{0};   ///< Reachable nodes, root and leaves included (the root always exists)
+        std::size_t leaf_count{0};   ///< Nodes at depth capacity, each holding at least one value
+        std::size_t value_count{0};  ///< Stored values, duplicates included
+        /// fan_out[level]: average number of children of the nodes at that
+        /// level (between 1 and 2; 0 for an empty tree)
+        std::vector<double> fan_out;
+        /// memory_usage() divided by value_count (0 if nothing is stored)
+        double bytes_per_set{0.0};
+    };
+
     /**
      * @brief Constructs a searcher for binary_sets with the specified capacity.
      *
      * @param capacity The capacity that all managed binary_sets must have
+     * @param mode How add() treats sets related by inclusion to stored ones
+     * @param index_values Whether to keep a value -> leaf index, which enables
+     * remove(value) at the cost of one hash map entry per stored set
+     *
+     * @throw std::invalid_argument If index_values is set but Value cannot
+     * key a hash map
      */
-    explicit bs_searcher(unsigned int capacity) : root_(std::make_unique<treenode>()), capacity_(capacity) {}
+    explicit basic_bs_searcher(unsigned int capacity, insert_mode mode = insert_mode::plain, bool index_values = false)
+        : nodes_(1),
+          capacity_(capacity),
+          mode_(mode),
+          indexed_(index_values),
+          order_(capacity),
+          query_absent_counts_(capacity, 0) {
+        if (index_values && !indexable) {
+            throw std::invalid_argument("The value index needs an equality comparable, hashable payload.");
+        }
+        for (unsigned int i = 0; i < capacity_; ++i) order_[i] = i;
+    }
 
     /**
      * @brief Adds a binary_set to the search structure.
      *
      * Multiple sets with the same value or structure can be added.
      *
+     * In keep_minimal mode, bs is refused if a stored set is a subset of it
+     * (equal sets included), otherwise every stored strict superset of bs is
+     * removed first. keep_maximal mirrors this with supersets and subsets.
+     *
      * @param value Identifier/alias for this set (need not be unique)
      * @param bs The binary_set to add
+     * @return true if bs was stored
+     * @return false if bs was refused by the insert mode
      *
      * @throw std::invalid_argument If bs has a different capacity than
      * specified in constructor
      */
-    void add(unsigned int value, const binary_set &bs) {
+    bool add(const Value &value, const binary_set &bs) {
         validate_capacity(bs);
 
-        treenode *leaf = root_.get();
+        if (mode_ != insert_mode::plain) {
+            const bool minimal = mode_ == insert_mode::keep_minimal;
+            const level_query set(bs, order_);
+            const level_query full(full_set(), order_);
+            auto found = [](const treenode *, const binary_set &) { return true; };
 
-        // Traverse the tree according to the binary_set (present -> right,
-        // absent
-        // -> left)
-        for (unsigned int i = 0; i < capacity_; ++i) {
-            if (bs[i]) {
-                if (!leaf->right) {
-                    leaf->right = std::make_unique<treenode>();
-                }
-                leaf = leaf->right.get();
+            // A stored set dominating bs (equal sets included) refuses it
+            const bool dominated = minimal ? search_between(nullptr, set, found) : search_between(&set, full, found);
+            if (dominated) return false;
+
+            // bs is not stored, so every set it dominates is a strict one
+            std::vector<std::pair<std::vector<Value>, binary_set>> evicted;
+            auto collect = [this, &evicted](const treenode *leaf, const binary_set &path) {
+                const std::span<const Value> values = values_of(*leaf);
+                evicted.emplace_back(std::vector<Value>(values.begin(), values.end()), path);
+                return false;
+            };
+            if (minimal) {
+                search_between(&set, full, collect);
             } else {
-                if (!leaf->left) {
-                    leaf->left = std::make_unique<treenode>();
-                }
-                leaf = leaf->left.get();
+                search_between(nullptr, set, collect);
+            }
+            for (const auto &[values, path] : evicted) {
+                for (const Value &evicted_value : values) remove(evicted_value, path);
             }
         }
 
-        // Store the value at the leaf
-        leaf->values.push_back(value);
+        insert(value, bs);
+        if (cache_.enabled()) cache_.invalidate_supersets(bs);
+        return true;
     }
 
     /**
@@ -649,55 +1003,51 @@ class bs_searcher {
      * @throw std::invalid_argument If bs has a different capacity than
      * specified in constructor
      */
-    bool remove(unsigned int value, const binary_set &bs) {
+    bool remove(const Value &value, const binary_set &bs) {
         validate_capacity(bs);
 
-        std::vector<treenode *> path;
-        std::vector<bool> is_right_child;
-        path.reserve(capacity_);
-        is_right_child.reserve(capacity_);
-
-        treenode *node = root_.get();
+        // If we didn't reach a leaf, the set wasn't in the tree
+        const treenode *leaf = leaf_of(bs);
+        if (!leaf) return false;
 
-        // Traverse to the leaf node containing the value
-        for (unsigned int i = 0; i < capacity_ && node; ++i) {
-            path.push_back(node);
-            is_right_child.push_back(bs[i]);
-            node = (bs[i] ? node->right.get() : node->left.get());
-        }
+        const std::span<const Value> values = values_of(*leaf);
+        auto it = std::find(values.begin(), values.end(), value);
+        if (it == values.end()) return false;
 
-        // If we didn't reach a node, the element wasn't in the tree
-        if (!node) return false;
-
-        // Find and remove the value using efficient swap-and-pop
-        auto it = std::find(node->values.begin(), node->values.end(), value);
-        if (it == node->values.end()) return false;
+        erase_value(static_cast<std::uint32_t>(leaf - nodes_.data()), static_cast<std::size_t>(it - values.begin()));
+        return true;
+    }
 
-        // Swap with last element and pop (more efficient than erase)
-        if (it != node->values.end() - 1) {
-            *it = node->values.back();
+    /**
+     * @brief Removes a set by its identifier alone.
+     *
+     * Looks the value up in the value -> leaf index, so neither the set nor a
+     * scan of the leaf is needed: the value itself is removed in O(1)
+     * amortized time. The root-to-leaf path is only walked, in O(capacity),
+     * to prune the branch when the leaf empties, or to recover the set when
+     * the query cache is enabled.
+     *
+     * If the value identifies several stored sets, only one of them is
+     * removed.
+     *
+     * @param value The identifier of the set to remove
+     * @return true if a set with this identifier was found and removed
+     * @return false if no set has this identifier
+     *
+     * @throw std::logic_error If the searcher was constructed without
+     * index_values
+     */
+    bool remove(const Value &value)
+        requires indexable
+    {
+        if (!indexed_) {
+            throw std::logic_error("bs_searcher::remove(value) requires a searcher constructed with index_values.");
         }
-        node->values.pop_back();
 
-        // Prune empty branches from leaf to root
-        if (node->values.empty() && !node->left && !node->right) {
-            for (std::size_t i = path.size(); i > 0; --i) {
-                treenode *parent = path[i - 1];
-                bool is_right = is_right_child[i - 1];
-
-                if (is_right) {
-                    parent->right.reset();
-                } else {
-                    parent->left.reset();
-                }
-
-                // Stop pruning if parent has values or other children
-                if (!parent->values.empty() || parent->left || parent->right) {
-                    break;
-                }
-            }
-        }
+        auto it = value_index_.find(value);
+        if (it == value_index_.end()) return false;
 
+        erase_value(it->second.leaf, it->second.position);
         return true;
     }
 
@@ -707,69 +1057,3496 @@ class bs_searcher {
      * A stored set S is a subset of query set Q if every element in S is also
      * in Q.
      *
+     * Below the last level whose element Q lacks, every stored set matches:
+     * the traversal stops at that level and takes each remaining subtree
+     * whole, without testing its nodes. While the value pool is in
+     * depth-first order (after bulk_load(), rebuild() or a compaction), each
+     * such subtree's values are copied as one block.
+     *
      * @param bs The query binary_set
-     * @return std::vector<unsigned int> Identifiers of all stored sets that are
+     * @return std::vector<Value> Identifiers of all stored sets that are
      * subsets of bs
      *
      * @throw std::invalid_argument If bs has a different capacity than
      * specified in constructor
      */
     [[nodiscard]]
-    std::vector<unsigned int> find_subsets(const binary_set &bs) const {
+    std::vector<Value> find_subsets(const binary_set &bs) const {
         validate_capacity(bs);
 
-        // Use two vectors for level-by-level tree traversal
-        std::vector<const treenode *> current_level;
-        std::vector<const treenode *> next_level;
-        current_level.reserve(capacity_);
-        next_level.reserve(capacity_ * 2);
+        if (!cache_.enabled()) return collect_runs(subset_runs(bs));
 
-        if (root_) current_level.push_back(root_.get());
+        std::vector<Value> result;
+        if (cache_.lookup(bs, result)) return result;
+        result = collect_runs(subset_runs(bs));
+        cache_.store(bs, result);
+        return result;
+    }
 
-        // Traverse the tree level by level
-        for (unsigned int i = 0; i < capacity_ && !current_level.empty(); ++i) {
-            next_level.clear();
+    /**
+     * @brief Finds the stored subsets of the query set within a size range.
+     *
+     * Subtrees are pruned on the number of elements taken along the path
+     * plus the fewest and most elements the sets below them still hold, so
+     * the sets outside the range are never reached rather than filtered out.
+     * Pass min_size == max_size for subsets of exactly that size.
+     *
+     * @param bs The query binary_set
+     * @param min_size Smallest size of a reported subset
+     * @param max_size Largest size of a reported subset
+     * @return std::vector<Value> Identifiers of all stored subsets S of bs
+     * with min_size <= |S| <= max_size (empty if min_size > max_size)
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_subsets(const binary_set &bs, unsigned int min_size, unsigned int max_size) const {
+        validate_capacity(bs);
 
-            for (const auto *node : current_level) {
-                if (bs[i]) {
-                    // If element is in query set, a subset could have it or not
-                    if (node->left) next_level.push_back(node->left.get());
-                    if (node->right) next_level.push_back(node->right.get());
-                } else {
-                    // If element is not in query set, subset must not have it
-                    // either
-                    if (node->left) next_level.push_back(node->left.get());
-                }
-            }
+        return collect_values(sized_leaves(bs, min_size, max_size));
+    }
 
-            current_level.swap(next_level);
-        }
+    /**
+     * @brief Finds the stored sets that are subsets of the query set except
+     * for at most k elements.
+     *
+     * The traversal carries a violation budget: following a present branch
+     * on an element absent from the query uses up one unit. Subtrees are
+     * pruned as soon as the budget is spent, or when the node summaries show
+     * that every set below needs more violations than are left.
+     *
+     * @param bs The query binary_set
+     * @param k Number of elements a reported set may hold outside bs
+     * @return std::vector<Value> Identifiers of all stored sets S with
+     * |S - bs| <= k (find_subsets(bs) for k == 0)
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_near_subsets(const binary_set &bs, unsigned int k) const {
+        validate_capacity(bs);
 
-        // Calculate total size needed for result vector
-        std::size_t total_values = 0;
-        for (const auto *node : current_level) {
-            total_values += node->values.size();
-        }
+        return collect_values(near_leaves(bs, k));
+    }
 
-        // Pre-allocate and collect all values from leaves
-        std::vector<unsigned int> result;
-        result.reserve(total_values);
+    /**
+     * @brief Finds the stored sets equal to the given set.
+     *
+     * Follows the single root-to-leaf path of bs.
+     *
+     * @param bs The binary_set to look up
+     * @return std::vector<Value> Identifiers of all stored sets equal to bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_exact(const binary_set &bs) const {
+        validate_capacity(bs);
 
-        for (const auto *node : current_level) {
-            result.insert(result.end(), node->values.begin(), node->values.end());
-        }
+        const treenode *leaf = leaf_of(bs);
+        if (!leaf) return {};
+
+        const std::span<const Value> values = values_of(*leaf);
+        return std::vector<Value>(values.begin(), values.end());
+    }
+
+    /**
+     * @brief Finds the stored sets lying between two sets.
+     *
+     * Elements of lower are required and elements outside upper are
+     * forbidden: the traversal follows only the present branch where lower
+     * has the element, only the absent branch where upper lacks it, and both
+     * otherwise.
+     *
+     * @param lower Elements every reported set must hold
+     * @param upper Elements a reported set may hold
+     * @return std::vector<Value> Identifiers of all stored sets S with
+     * lower <= S <= upper (empty if lower is not a subset of upper)
+     *
+     * @throw std::invalid_argument If lower or upper has a different capacity
+     * than specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_between(const binary_set &lower, const binary_set &upper) const {
+        validate_capacity(lower);
+        validate_capacity(upper);
 
+        std::vector<Value> result;
+        const level_query low(lower, order_);
+        const level_query up(upper, order_);
+        search_between(&low, up, [this, &result](const treenode *leaf, const binary_set &) {
+            const std::span<const Value> values = values_of(*leaf);
+            result.insert(result.end(), values.begin(), values.end());
+            return false;
+        });
         return result;
     }
 
-   private:
-    std::unique_ptr<treenode> root_;
-    unsigned int capacity_;
+    /**
+     * @brief Finds the stored sets matching a ternary pattern.
+     *
+     * Each element of the pattern is either cared about, in which case it
+     * must be present in a matching set if it is in value and absent
+     * otherwise, or a wildcard. The pattern is turned into the bounds
+     * care & value <= S <= !(care - value) and answered by find_between() in
+     * a single traversal.
+     *
+     * @param care Elements constrained by the pattern
+     * @param value Required presence of the cared elements (elements outside
+     * care are ignored)
+     * @return std::vector<Value> Identifiers of all stored sets S with
+     * S & care == value & care
+     *
+     * @throw std::invalid_argument If care or value has a different capacity
+     * than specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_matching(const binary_set &care, const binary_set &value) const {
+        validate_capacity(care);
+        validate_capacity(value);
 
-    void validate_capacity(const binary_set &bs) const {
-        if (capacity_ != bs.capacity()) {
-            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        return find_between(care & value, !(care - value));
+    }
+
+    /**
+     * @brief Finds the stored sets sharing at least one element with the
+     * query set.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<Value> Identifiers of all stored sets that
+     * intersect bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_intersecting(const binary_set &bs) const {
+        return find_overlapping(bs, 1);
+    }
+
+    /**
+     * @brief Finds the stored sets sharing at least t elements with the query
+     * set.
+     *
+     * The traversal counts the overlap along each path and prunes a subtree
+     * when its summaries show that no stored set below can bring the overlap
+     * up to t: neither its largest set, nor the query elements that some set
+     * below holds within the next 64 levels (plus all those further down).
+     *
+     * @param bs The query binary_set
+     * @param t Minimum number of shared elements
+     * @return std::vector<Value> Identifiers of all stored sets S with
+     * |S & bs| >= t (every stored set for t == 0)
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_overlapping(const binary_set &bs, unsigned int t) const {
+        validate_capacity(bs);
+
+        return collect_values(overlap_leaves(bs, t));
+    }
+
+    /**
+     * @brief Finds all stored subsets of the query set, without copying.
+     *
+     * Returns one span per matching leaf, viewing the values stored there.
+     * The spans stay valid until the searcher is next modified.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<std::span<const Value>> Views of the values of all
+     * stored sets that are subsets of bs, one span per distinct set
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<std::span<const Value>> find_subset_spans(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        const std::vector<const treenode *> leaves = matching_leaves(bs, nullptr);
+
+        std::vector<std::span<const Value>> result;
+        result.reserve(leaves.size());
+        for (const auto *node : leaves) {
+            result.push_back(values_of(*node));
         }
+        return result;
+    }
+
+    /**
+     * @brief Marks the values of all stored subsets of the query set in a
+     * bitmap.
+     *
+     * Meant for identifiers forming a dense range 0..N: instead of a result
+     * vector, out gains element v for every value v of a stored subset of bs,
+     * ready to be combined with other filters through binary_set's &=, |= and
+     * -=. Elements already in out are kept, so clear() it first to get the
+     * matches alone. The cache is neither consulted nor filled.
+     *
+     * Values are marked during the traversal: neither a result vector nor a
+     * list of value runs is built. The traversal itself still allocates the
+     * query's level-order copy and its two level buffers, plus one stack for
+     * the matching subtrees of a pool left unordered by updates. Since the
+     * traversal dominates, this is about as fast as converting the
+     * find_subsets() result; the gain is the memory of that result.
+     *
+     * @param bs The query binary_set
+     * @param out Bitmap receiving the matching values
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     * @throw std::out_of_range If a matching value is negative or not below
+     * out.capacity() (out then holds the values marked before it)
+     */
+    void find_subsets_bitmap(const binary_set &bs, binary_set &out) const
+        requires std::integral<Value>
+    {
+        validate_capacity(bs);
+
+        for_each_subset_run(level_query(bs, order_), [this, &out](value_run run) {
+            for (const Value &value : std::span<const Value>(values_.data() + run.begin, run.end - run.begin)) {
+                if (std::cmp_less(value, 0) || std::cmp_greater_equal(value, out.capacity())) {
+                    throw std::out_of_range("A matching value does not fit in the output bitmap.");
+                }
+                out.add(static_cast<unsigned int>(value));
+            }
+        });
+    }
+
+    /**
+     * @brief Counts the tree nodes find_subsets() visits for a query.
+     *
+     * Useful to measure how well the current element order prunes a workload.
+     *
+     * @param bs The query binary_set
+     * @return std::size_t Number of nodes visited, root and leaves included
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::size_t visited_nodes(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        std::size_t visited = 0;
+        (void)matching_leaves(bs, &visited);
+        return visited;
+    }
+
+    /**
+     * @brief Finds the minimal stored subsets of the query set.
+     *
+     * A stored subset S of bs is minimal if no other stored set is a strict
+     * subset of S. Each candidate is checked with a pruned search for a strict
+     * subset instead of being compared against every other result.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<Value> Identifiers of all minimal stored
+     * subsets of bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_minimal_subsets(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        std::vector<Value> result;
+        const level_query query(bs, order_);
+        search_between(nullptr, query, [this, &result](const treenode *leaf, const binary_set &path) {
+            const level_query candidate(path, order_);
+            const bool dominated = search_between(nullptr, candidate, [leaf](const treenode *other, const binary_set &) { return other != leaf; });
+            if (!dominated) {
+                const std::span<const Value> values = values_of(*leaf);
+                result.insert(result.end(), values.begin(), values.end());
+            }
+            return false;
+        });
+        return result;
+    }
+
+    /**
+     * @brief Finds the maximal stored subsets of the query set.
+     *
+     * A stored subset S of bs is maximal if no other stored subset of bs is a
+     * strict superset of S.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<Value> Identifiers of all maximal stored
+     * subsets of bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_maximal_subsets(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        std::vector<Value> result;
+        const level_query query(bs, order_);
+        search_between(nullptr, query, [this, &query, &result](const treenode *leaf, const binary_set &path) {
+            const level_query candidate(path, order_);
+            const bool dominated = search_between(&candidate, query, [leaf](const treenode *other, const binary_set &) { return other != leaf; });
+            if (!dominated) {
+                const std::span<const Value> values = values_of(*leaf);
+                result.insert(result.end(), values.begin(), values.end());
+            }
+            return false;
+        });
+        return result;
+    }
+
+    /**
+     * @brief Records a query in the statistics used by rebuild().
+     *
+     * find_subsets() does not record queries by itself: call this on a sample
+     * of the expected workload before rebuilding.
+     *
+     * @param bs The query binary_set
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    void observe_query(const binary_set &bs) {
+        validate_capacity(bs);
+
+        const set_words words(bs);
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            query_absent_counts_[i] += !words.holds(i);
+        }
+        ++observed_queries_;
+    }
+
+    /**
+     * @brief Re-optimizes the element order and rebuilds the tree with it.
+     *
+     * Elements are ranked by how often they are present in stored sets times
+     * how often they are absent from the observed queries (or by stored
+     * frequency alone if no query was observed). Those are the elements whose
+     * right branch a query is most likely to cut, so testing them first prunes
+     * the traversal closer to the root. Ties keep index order.
+     *
+     * Time complexity: O(capacity * number_of_stored_values)
+     */
+    void rebuild() {
+        // Collect every stored entry before dropping the old tree, counting
+        // the stored sets that contain each element on the way
+        std::vector<std::pair<Value, binary_set>> entries;
+        std::vector<std::size_t> stored_counts(capacity_, 0);
+        for_each_entry([this, &entries, &stored_counts](const Value &value, const binary_set &bs) {
+            const set_words words(bs);
+            for (unsigned int e = 0; e < capacity_; ++e) stored_counts[e] += words.holds(e);
+            entries.emplace_back(value, bs);
+        });
+
+        std::vector<double> score(capacity_);
+        for (unsigned int e = 0; e < capacity_; ++e) {
+            const double absent_ratio =
+                observed_queries_ == 0 ? 1.0 : static_cast<double>(query_absent_counts_[e]) / static_cast<double>(observed_queries_);
+            score[e] = static_cast<double>(stored_counts[e]) * absent_ratio;
+        }
+
+        std::vector<unsigned int> order(capacity_);
+        for (unsigned int i = 0; i < capacity_; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&score](unsigned int a, unsigned int b) { return score[a] > score[b]; });
+
+        order_ = std::move(order);
+        build(entries);
+    }
+
+    /**
+     * @brief Replaces the contents of the searcher with a batch of sets.
+     *
+     * Instead of walking the tree once per set, the sets are encoded in level
+     * order, radix sorted by bit pattern, and the tree is built bottom-up in a
+     * single pass: consecutive sorted sets share their common prefix, so each
+     * new node is appended to the pool exactly once, in depth-first order.
+     *
+     * In keep_minimal and keep_maximal modes the sets are added one by one
+     * with add(), so that dominated sets are still refused.
+     *
+     * @param entries Range of (value, binary_set) pairs
+     *
+     * @throw std::invalid_argument If a binary_set has a different capacity
+     * than specified in constructor (the searcher is then left unchanged)
+     */
+    template <typename Range>
+    void bulk_load(const Range &entries) {
+        for (const auto &[value, bs] : entries) {
+            validate_capacity(bs);
+        }
+
+        if (mode_ != insert_mode::plain) {
+            clear();
+            for (const auto &[value, bs] : entries) {
+                add(value, bs);
+            }
+            return;
+        }
+
+        build(entries);
+    }
+
+    /**
+     * @brief Adds a batch of sets, building their subtrees on several threads.
+     *
+     * The sets are encoded in level order and split by their first levels
+     * into up to 256 partitions. Worker threads take the partitions one at a
+     * time, radix sort them and build each one's subtree bottom-up, as
+     * bulk_load() does, in an arena of their own. The subtrees are then
+     * spliced into the pools under the shared top levels. A partition whose
+     * top-level path already leads to stored sets is added set by set instead.
+     *
+     * In keep_minimal and keep_maximal modes the sets are added one by one
+     * with add(), so that dominated sets are still refused.
+     *
+     * The pools are checked and reserved for all the spliced subtrees before
+     * the first one is spliced, so running out of room there leaves the
+     * searcher unchanged. Past that point only value index entries and the
+     * sets added one by one can fail to allocate: the searcher then stays
+     * valid, holding its previous sets and part of the batch.
+     *
+     * @param entries Range of (value, binary_set) pairs
+     * @param thread_count Maximum number of worker threads, 0 for one per
+     * hardware thread
+     *
+     * @throw std::invalid_argument If a binary_set has a different capacity
+     * than specified in constructor (the searcher is then left unchanged)
+     * @throw std::system_error If a worker thread cannot be started (the
+     * searcher is then left unchanged)
+     * @throw std::length_error If the spliced subtrees would overflow the
+     * node or value pool (the searcher is then left unchanged)
+     */
+    template <typename Range>
+    void add_parallel(const Range &entries, unsigned int thread_count = 0) {
+        for (const auto &[value, bs] : entries) {
+            validate_capacity(bs);
+        }
+
+        if (mode_ != insert_mode::plain || capacity_ == 0) {
+            for (const auto &[value, bs] : entries) {
+                add(value, bs);
+            }
+            return;
+        }
+
+        const std::size_t words = key_words();
+        std::vector<Value> values;
+        std::vector<std::uint64_t> keys;
+        for (const auto &[value, bs] : entries) {
+            values.push_back(value);
+            keys.resize(keys.size() + words, 0);
+            encode_key(bs, keys.data() + keys.size() - words);
+        }
+        if (values.empty()) return;
+
+        // Group the entries by the partition their first levels select
+        const unsigned int prefix_levels = std::min(capacity_, parallel_prefix_levels);
+        const std::size_t partitions = std::size_t{1} << prefix_levels;
+        auto partition_of = [&](std::size_t entry) { return static_cast<std::size_t>(keys[entry * words] >> (64 - prefix_levels)); };
+        std::vector<std::size_t> offsets(partitions + 1, 0);
+        for (std::size_t i = 0; i < values.size(); ++i) ++offsets[partition_of(i) + 1];
+        for (std::size_t p = 0; p < partitions; ++p) offsets[p + 1] += offsets[p];
+        std::vector<std::size_t> perm(values.size());
+        {
+            std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < values.size(); ++i) perm[next[partition_of(i)]++] = i;
+        }
+
+        // Sort and build the partitions concurrently
+        std::vector<arena> built(partitions);
+        std::atomic<std::size_t> next_partition{0};
+        auto work = [&] {
+            for (std::size_t p = next_partition++; p < partitions; p = next_partition++) {
+                if (offsets[p] == offsets[p + 1]) continue;
+                const std::span<std::size_t> part(perm.data() + offsets[p], offsets[p + 1] - offsets[p]);
+                radix_sort(keys, part);
+                built[p] = build_subtree(keys, part, values, prefix_levels);
+            }
+        };
+        if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::exception_ptr> errors(thread_count);
+        {
+            // jthreads join when the scope ends, also if starting one throws
+            std::vector<std::jthread> threads;
+            threads.reserve(thread_count - 1);
+            for (unsigned int t = 1; t < thread_count; ++t) {
+                threads.emplace_back([&work, &errors, t] {
+                    try {
+                        work();
+                    } catch (...) {
+                        errors[t] = std::current_exception();
+                    }
+                });
+            }
+            try {
+                work();
+            } catch (...) {
+                errors[0] = std::current_exception();
+            }
+        }
+        for (const std::exception_ptr &error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+        // A partition is spliced whole unless its top-level path already leads
+        // to stored sets. The pools are checked and reserved for every spliced
+        // partition up front, so that splicing them cannot throw.
+        std::vector<bool> spliced(partitions, false);
+        std::size_t new_nodes = 0;
+        std::size_t new_values = 0;
+        for (std::size_t p = 0; p < partitions; ++p) {
+            if (offsets[p] == offsets[p + 1]) continue;
+
+            // Child links are never 0, the root's index
+            std::uint32_t node = 0;
+            bool reached = true;
+            for (unsigned int d = 0; d + 1 < prefix_levels && reached; ++d) {
+                node = (p >> (prefix_levels - 1 - d)) & 1u ? nodes_[node].right : nodes_[node].left;
+                reached = node != 0;
+            }
+            spliced[p] = !reached || ((p & 1u) ? nodes_[node].right : nodes_[node].left) == 0;
+            if (spliced[p]) {
+                new_nodes += prefix_levels - 1 + built[p].nodes.size();
+                new_values += built[p].values.size();
+            }
+        }
+        if (nodes_.size() + new_nodes > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The bs_searcher node pool is full.");
+        }
+        if (values_.size() + new_values > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The bs_searcher value pool is full.");
+        }
+        nodes_.reserve(nodes_.size() + new_nodes);
+        values_.reserve(values_.size() + new_values);
+        std::vector<std::uint32_t> path;
+        path.reserve(prefix_levels);
+
+        // Splice the subtrees in left-to-right order under the shared levels
+        ++version_;
+        if (cache_.enabled()) cache_.clear();
+        for (std::size_t p = 0; p < partitions; ++p) {
+            if (!spliced[p]) continue;
+
+            path.clear();
+            std::uint32_t node = 0;
+            for (unsigned int d = 0; d + 1 < prefix_levels; ++d) {
+                path.push_back(node);
+                const bool present = (p >> (prefix_levels - 1 - d)) & 1u;
+                std::uint32_t child = present ? nodes_[node].right : nodes_[node].left;
+                if (!child) {
+                    child = allocate();
+                    (present ? nodes_[node].right : nodes_[node].left) = child;
+                    nodes_[child].parent = node;
+                }
+                node = child;
+            }
+            path.push_back(node);
+
+            splice(built[p], node, p & 1u);
+            refresh_path(path);
+            built[p] = arena{};
+        }
+
+        // The remaining partitions join existing subtrees set by set
+        for (std::size_t p = 0; p < partitions; ++p) {
+            if (spliced[p]) continue;
+            for (std::size_t i = offsets[p]; i < offsets[p + 1]; ++i) insert(values[perm[i]], decode_key(keys.data() + perm[i] * words));
+        }
+    }
+
+    /**
+     * @brief Moves every set of another searcher into this one.
+     *
+     * Both trees are walked in lockstep from the root. Where only other has a
+     * subtree, the whole subtree is copied across node by node, summaries
+     * included; where both have a leaf, other's values are appended to it.
+     * The cost is thus proportional to other's nodes, not to its sets times
+     * the capacity, and subtrees only this searcher has are not visited.
+     *
+     * If the element orders differ, or in keep_minimal and keep_maximal
+     * modes, other's sets are added one by one with add() instead.
+     *
+     * @param other Searcher to empty into this one; left empty
+     *
+     * @throw std::invalid_argument If other has a different capacity or is
+     * this searcher
+     */
+    void merge(basic_bs_searcher &&other) {
+        if (&other == this) throw std::invalid_argument("Cannot merge a bs_searcher into itself.");
+        if (other.capacity_ != capacity_) throw std::invalid_argument("The two bs_searcher don't have the same capacity.");
+
+        if (mode_ != insert_mode::plain || other.order_ != order_) {
+            other.for_each_entry([this](const Value &value, const binary_set &bs) { add(value, bs); });
+            other.clear();
+            return;
+        }
+
+        ++version_;
+        if (cache_.enabled()) cache_.clear();
+        nodes_.reserve(nodes_.size() + other.nodes_.size());
+        values_.reserve(values_.size() + other.values_.size());
+
+        // Pairs of nodes at the same path; each is refreshed once its children are merged
+        struct frame {
+            std::uint32_t mine;
+            std::uint32_t theirs;
+            bool merged;
+        };
+        std::vector<frame> stack = {{0, 0, false}};
+        while (!stack.empty()) {
+            if (stack.back().merged) {
+                refresh(stack.back().mine);
+                stack.pop_back();
+                continue;
+            }
+            stack.back().merged = true;
+            const std::uint32_t mine = stack.back().mine;
+            const treenode &theirs = other.nodes_[stack.back().theirs];
+
+            for (const Value &value : other.values_of(theirs)) {
+                const std::uint32_t position = append_value(mine, value);
+                if constexpr (indexable) {
+                    if (indexed_) value_index_.emplace(value, leaf_slot{mine, position});
+                }
+            }
+            for (const bool right : {false, true}) {
+                const std::uint32_t their_child = right ? theirs.right : theirs.left;
+                if (!their_child) continue;
+                const std::uint32_t my_child = right ? nodes_[mine].right : nodes_[mine].left;
+                if (my_child) {
+                    stack.push_back({my_child, their_child, false});
+                } else {
+                    adopt_subtree(other, their_child, mine, right);
+                }
+            }
+        }
+
+        other.clear();
+        compact_if_sparse();
+    }
+
+    /**
+     * @brief Moves the stored sets matching a predicate into a new searcher.
+     *
+     * The extracted entries are removed as remove() would, and the new
+     * searcher is built from them bottom-up, as bulk_load() does.
+     *
+     * @param pred Called as pred(value, set) once for every stored entry
+     * @return basic_bs_searcher Searcher with the same capacity, insert mode,
+     * value index setting and element order, holding the extracted entries
+     */
+    template <typename Predicate>
+    [[nodiscard]]
+    basic_bs_searcher extract_if(Predicate pred) {
+        std::vector<std::pair<Value, binary_set>> extracted;
+        std::vector<leaf_slot> slots;
+        const level_query full(full_set(), order_);
+        search_between(nullptr, full, [this, &pred, &extracted, &slots](const treenode *leaf, const binary_set &path) {
+            const std::span<const Value> values = values_of(*leaf);
+            for (std::size_t position = 0; position < values.size(); ++position) {
+                if (!pred(values[position], path)) continue;
+                extracted.emplace_back(values[position], path);
+                slots.push_back({static_cast<std::uint32_t>(leaf - nodes_.data()), static_cast<std::uint32_t>(position)});
+            }
+            return false;
+        });
+
+        // Last positions of each leaf first, so that swap-and-pop keeps the others in place
+        for (auto it = slots.rbegin(); it != slots.rend(); ++it) erase_value(it->leaf, it->position);
+
+        basic_bs_searcher result(capacity_, mode_, indexed_);
+        result.order_ = order_;
+        result.build(extracted);
+        return result;
+    }
+
+    /**
+     * @brief Removes every stored set.
+     *
+     * The element order and the observed query statistics are kept.
+     */
+    void clear() {
+        nodes_.assign(1, treenode{});
+        free_nodes_.clear();
+        values_.clear();
+        dead_values_ = 0;
+        values_ordered_ = true;
+        cache_.clear();
+        ++version_;
+        if constexpr (indexable) value_index_.clear();
+    }
+
+    /**
+     * @brief Sets the number of find_subsets() results kept in the cache.
+     *
+     * The cache is disabled (capacity 0) by default. Once full, entries are
+     * evicted with the CLOCK algorithm: a hit marks an entry, and the
+     * eviction hand spares marked entries once. Setting the capacity empties
+     * the cache and resets its counters.
+     *
+     * Lookups are guarded by a mutex, so concurrent find_subsets() calls stay
+     * safe.
+     *
+     * @param entries Maximum number of cached queries, 0 to disable the cache
+     */
+    void set_cache_capacity(std::size_t entries) {
+        cache_.resize(entries);
+    }
+
+    /**
+     * @brief Returns the number of find_subsets() calls answered by the cache.
+     *
+     * @return std::size_t Cache hits since the capacity was last set
+     */
+    [[nodiscard]]
+    std::size_t cache_hits() const {
+        return cache_.hits();
+    }
+
+    /**
+     * @brief Returns the number of find_subsets() calls the cache could not
+     * answer.
+     *
+     * @return std::size_t Cache misses since the capacity was last set
+     */
+    [[nodiscard]]
+    std::size_t cache_misses() const {
+        return cache_.misses();
+    }
+
+    /**
+     * @brief Estimates the heap and object memory held by the searcher.
+     *
+     * Counts allocated capacity, not just the used part: the node pool,
+     * including free-listed nodes, the value pool, including dead ranges not
+     * compacted yet, the value index, the query cache, and the element order
+     * and query statistics. Hash map nodes are estimated as their entry plus
+     * one pointer. Reading the query cache's size takes its lock.
+     *
+     * @return std::size_t Size in bytes
+     */
+    [[nodiscard]]
+    std::size_t memory_usage() const {
+        std::size_t bytes = sizeof(*this);
+        bytes += nodes_.capacity() * sizeof(treenode);
+        bytes += free_nodes_.capacity() * sizeof(std::uint32_t);
+        bytes += order_.capacity() * sizeof(order_[0]);
+        bytes += query_absent_counts_.capacity() * sizeof(query_absent_counts_[0]);
+        bytes += values_.capacity() * sizeof(Value);
+        bytes += cache_.memory_usage();
+        if constexpr (indexable) {
+            bytes += value_index_.bucket_count() * sizeof(void *);
+            bytes += value_index_.size() * (sizeof(std::pair<const Value, leaf_slot>) + sizeof(void *));
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Reports the shape of the tree.
+     *
+     * Walks the tree level by level, so the cost is linear in the number of
+     * nodes.
+     *
+     * @return statistics Node, leaf and value counts, fan-out per level and
+     * bytes per stored set
+     */
+    [[nodiscard]]
+    statistics stats() const {
+        statistics result;
+        result.fan_out.assign(capacity_, 0.0);
+
+        std::vector<const treenode *> current_level;
+        std::vector<const treenode *> next_level;
+        current_level.push_back(nodes_.data());
+
+        for (unsigned int level = 0; level < capacity_ && !current_level.empty(); ++level) {
+            next_level.clear();
+            for (const treenode *node : current_level) {
+                if (node->left) next_level.push_back(&nodes_[node->left]);
+                if (node->right) next_level.push_back(&nodes_[node->right]);
+            }
+            result.node_count += current_level.size();
+            result.fan_out[level] = static_cast<double>(next_level.size()) / static_cast<double>(current_level.size());
+            std::swap(current_level, next_level);
+        }
+
+        for (const treenode *leaf : current_level) {
+            if (leaf->value_count == 0) continue;
+            ++result.leaf_count;
+            result.value_count += leaf->value_count;
+        }
+        result.node_count += current_level.size();
+
+        if (result.value_count > 0) {
+            result.bytes_per_set = static_cast<double>(memory_usage()) / static_cast<double>(result.value_count);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the insert mode chosen at construction.
+     *
+     * @return insert_mode How add() treats sets related by inclusion
+     */
+    [[nodiscard]]
+    insert_mode mode() const noexcept {
+        return mode_;
+    }
+
+    /**
+     * @brief Returns the element tested at each level of the tree.
+     *
+     * @return const std::vector<unsigned int>& order, where order[level] is
+     * the element branched on at that level
+     */
+    [[nodiscard]]
+    const std::vector<unsigned int> &element_order() const noexcept {
+        return order_;
+    }
+
+    /**
+     * @brief Writes a snapshot of the searcher to a file.
+     *
+     * The snapshot is a flat, pointer-free image of the tree: nodes in
+     * depth-first order with child links stored as indices, followed by all
+     * values in one array, in the machine's native byte order. bs_searcher_view
+     * maps it back into memory, checking its indices in one pass over the
+     * nodes.
+     *
+     * @param path File to create or overwrite
+     *
+     * Only available for unsigned int payloads.
+     *
+     * @throw std::runtime_error If the file cannot be written
+     */
+    void save(const std::string &path) const
+        requires std::is_same_v<Value, unsigned int>
+    {
+        std::vector<flat_node> nodes;
+        std::vector<unsigned int> values;
+        flatten(nodes, values);
+
+        snapshot_header header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+        header.version = SNAPSHOT_VERSION;
+        header.capacity = capacity_;
+        header.node_count = nodes.size();
+        header.value_count = values.size();
+        const snapshot_layout layout(capacity_, nodes.size(), values.size());
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot open the snapshot file for writing.");
+
+        const char padding[8] = {};
+        out.write(reinterpret_cast<const char *>(&header), sizeof header);
+        out.write(reinterpret_cast<const char *>(order_.data()), static_cast<std::streamsize>(order_.size() * sizeof(unsigned int)));
+        out.write(padding, static_cast<std::streamsize>(layout.nodes_offset - layout.order_offset - order_.size() * sizeof(unsigned int)));
+        out.write(reinterpret_cast<const char *>(nodes.data()), static_cast<std::streamsize>(nodes.size() * sizeof(flat_node)));
+        out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(unsigned int)));
+
+        out.flush();
+        if (!out) throw std::runtime_error("Cannot write the snapshot file.");
+    }
+
+    /**
+     * @brief A find_subsets() query kept up to date as its elements change.
+     *
+     * Adding an element only explores the subtrees it opens: the stored sets
+     * holding that element and otherwise fitting in the query, found with
+     * the element as a lower bound. Removing an element drops the matches
+     * holding it without touching the tree.
+     *
+     * The live query reads the searcher it is bound to, which must outlive
+     * it. If the searcher's stored sets change, the next call re-runs the
+     * query from the root.
+     */
+    class live_query {
+       public:
+        /**
+         * @brief Runs query against searcher and keeps its result.
+         *
+         * @param searcher The searcher to query
+         * @param query The initial query binary_set
+         *
+         * @throw std::invalid_argument If query has a different capacity than
+         * the searcher
+         */
+        live_query(const basic_bs_searcher &searcher, const binary_set &query) : searcher_(&searcher), query_(query) {
+            searcher.validate_capacity(query);
+            recompute();
+        }
+
+        /**
+         * @brief Adds an element to the query and extends the result.
+         *
+         * @param element The element to add
+         * @return true if the element was added
+         * @return false if it was already in the query
+         *
+         * @throw std::out_of_range If element >= capacity
+         */
+        bool add_element(unsigned int element) {
+            if (!query_.add(element)) return false;
+            if (version_ != searcher_->version_) {
+                recompute();
+                return true;
+            }
+
+            binary_set lower(query_.capacity());
+            lower.add(element);
+            const level_query low(lower, searcher_->order_);
+            const level_query up(query_, searcher_->order_);
+            searcher_->search_between(&low, up, [this](const treenode *leaf, const binary_set &set) {
+                matches_.push_back({leaf, set});
+                return false;
+            });
+            return true;
+        }
+
+        /**
+         * @brief Removes an element from the query and shrinks the result.
+         *
+         * @param element The element to remove
+         * @return true if the element was removed
+         * @return false if it was not in the query
+         *
+         * @throw std::out_of_range If element >= capacity
+         */
+        bool remove_element(unsigned int element) {
+            if (!query_.remove(element)) return false;
+            if (version_ != searcher_->version_) {
+                recompute();
+                return true;
+            }
+
+            std::erase_if(matches_, [element](const match &m) { return m.set[element]; });
+            return true;
+        }
+
+        /**
+         * @brief Returns the identifiers of the stored subsets of the query.
+         *
+         * @return std::vector<Value> Same values as find_subsets(query())
+         */
+        [[nodiscard]]
+        std::vector<Value> results() {
+            if (version_ != searcher_->version_) recompute();
+
+            std::vector<const treenode *> leaves;
+            leaves.reserve(matches_.size());
+            for (const match &m : matches_) leaves.push_back(m.leaf);
+            return searcher_->collect_values(leaves);
+        }
+
+        /**
+         * @brief Returns the current query.
+         *
+         * @return const binary_set& The query
+         */
+        [[nodiscard]]
+        const binary_set &query() const noexcept {
+            return query_;
+        }
+
+       private:
+        struct match {
+            const treenode *leaf;
+            binary_set set;  // The stored set of the leaf
+        };
+
+        const basic_bs_searcher *searcher_;
+        binary_set query_;
+        std::vector<match> matches_;
+        std::uint64_t version_{0};  // Searcher version the matches belong to
+
+        void recompute() {
+            matches_.clear();
+            const level_query up(query_, searcher_->order_);
+            searcher_->search_between(nullptr, up, [this](const treenode *leaf, const binary_set &set) {
+                matches_.push_back({leaf, set});
+                return false;
+            });
+            version_ = searcher_->version_;
+        }
+    };
+
+   private:
+    // Where a stored value sits: leaf node and position in its values
+    struct leaf_slot {
+        std::uint32_t leaf;
+        std::uint32_t position;
+    };
+
+    // Range [begin, end) of the value pool
+    struct value_run {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // Subtree built apart from the pools, with indices local to it: node 0 is
+    // its root and leaf ranges index into values
+    struct arena {
+        std::vector<treenode> nodes;
+        std::vector<Value> values;
+    };
+
+    // Levels shared by the subtrees that add_parallel() builds concurrently
+    static constexpr unsigned int parallel_prefix_levels = 8;
+
+    // Whether Value can key the value index
+    static constexpr bool indexable = std::equality_comparable<Value> && requires(const Value &value) {
+        { std::hash<Value>{}(value) } -> std::convertible_to<std::size_t>;
+    };
+
+    // Stands in for the value index when Value cannot key one
+    struct no_index {};
+
+    using value_index = std::conditional_t<indexable, std::unordered_multimap<Value, leaf_slot>, no_index>;
+
+    // Bounded cache of find_subsets() results, evicting with the CLOCK
+    // algorithm. Lookups happen in const queries, so it has its own mutex;
+    // updates come from add/remove, which already need exclusive access.
+    class query_cache {
+       public:
+        query_cache() = default;
+
+        query_cache(const query_cache &other) {
+            std::lock_guard lock(other.mutex_);
+            copy_from(other);
+        }
+
+        query_cache &operator=(const query_cache &other) {
+            if (this != &other) {
+                std::scoped_lock lock(mutex_, other.mutex_);
+                copy_from(other);
+            }
+            return *this;
+        }
+
+        [[nodiscard]]
+        bool enabled() const noexcept {
+            return !slots_.empty();
+        }
+
+        void resize(std::size_t entries) {
+            std::lock_guard lock(mutex_);
+            slots_.assign(entries, slot{});
+            slot_of_.clear();
+            hand_ = 0;
+            hits_ = 0;
+            misses_ = 0;
+        }
+
+        void clear() {
+            std::lock_guard lock(mutex_);
+            for (slot &entry : slots_) entry = slot{};
+            slot_of_.clear();
+        }
+
+        // Copies the cached result of query into result, if there is one
+        bool lookup(const binary_set &query, std::vector<Value> &result) {
+            std::lock_guard lock(mutex_);
+            auto it = slot_of_.find(query);
+            if (it == slot_of_.end()) {
+                ++misses_;
+                return false;
+            }
+            ++hits_;
+            slots_[it->second].referenced = true;
+            result = slots_[it->second].result;
+            return true;
+        }
+
+        void store(const binary_set &query, const std::vector<Value> &result) {
+            std::lock_guard lock(mutex_);
+            if (slot_of_.count(query)) return;  // Stored by a concurrent miss
+
+            // Give referenced entries a second chance
+            while (slots_[hand_].live && slots_[hand_].referenced) {
+                slots_[hand_].referenced = false;
+                hand_ = (hand_ + 1) % slots_.size();
+            }
+
+            slot &victim = slots_[hand_];
+            if (victim.live) slot_of_.erase(victim.query);
+            victim.query = query;
+            victim.result = result;
+            victim.referenced = false;
+            victim.live = true;
+            slot_of_.emplace(query, hand_);
+            hand_ = (hand_ + 1) % slots_.size();
+        }
+
+        // Drops the cached queries that a newly stored set is a subset of
+        void invalidate_supersets(const binary_set &bs) {
+            std::lock_guard lock(mutex_);
+            for (slot &entry : slots_) {
+                if (!entry.live || !entry.query.contains(bs)) continue;
+                slot_of_.erase(entry.query);
+                entry = slot{};
+            }
+        }
+
+        // Drops a removed (value, bs) pair from the results that hold it
+        void drop(const Value &value, const binary_set &bs) {
+            std::lock_guard lock(mutex_);
+            for (slot &entry : slots_) {
+                if (!entry.live || !entry.query.contains(bs)) continue;
+                auto it = std::find(entry.result.begin(), entry.result.end(), value);
+                if (it != entry.result.end()) entry.result.erase(it);
+            }
+        }
+
+        [[nodiscard]]
+        std::size_t hits() const {
+            std::lock_guard lock(mutex_);
+            return hits_;
+        }
+
+        [[nodiscard]]
+        std::size_t misses() const {
+            std::lock_guard lock(mutex_);
+            return misses_;
+        }
+
+        [[nodiscard]]
+        std::size_t memory_usage() const {
+            std::lock_guard lock(mutex_);
+            std::size_t bytes = slots_.capacity() * sizeof(slot);
+            for (const slot &entry : slots_) {
+                bytes += entry.result.capacity() * sizeof(Value) + (entry.query.capacity() + 7) / 8;
+            }
+            bytes += slot_of_.bucket_count() * sizeof(void *);
+            bytes += slot_of_.size() * (sizeof(std::pair<const binary_set, std::size_t>) + sizeof(void *));
+            return bytes;
+        }
+
+       private:
+        struct slot {
+            binary_set query;
+            std::vector<Value> result;
+            bool referenced{false};  // Hit since the hand last passed
+            bool live{false};
+        };
+
+        std::vector<slot> slots_;
+        std::unordered_map<binary_set, std::size_t> slot_of_;  // Query -> slot
+        std::size_t hand_{0};
+        std::size_t hits_{0};
+        std::size_t misses_{0};
+        mutable std::mutex mutex_;
+
+        void copy_from(const query_cache &other) {
+            slots_ = other.slots_;
+            slot_of_ = other.slot_of_;
+            hand_ = other.hand_;
+            hits_ = other.hits_;
+            misses_ = other.misses_;
+        }
+    };
+
+    std::vector<treenode> nodes_;            // Node pool, nodes_[0] is the root
+    std::vector<std::uint32_t> free_nodes_;  // Released pool slots
+    std::vector<Value> values_;              // Value pool holding the leaf ranges
+    std::size_t dead_values_{0};             // Pool slots outside every leaf range
+    bool values_ordered_{true};              // Leaf ranges tile the value pool in depth-first order
+    mutable query_cache cache_;              // Optional find_subsets() result cache
+    std::uint64_t version_{0};               // Bumped by every change to the stored sets
+    unsigned int capacity_;
+    insert_mode mode_;
+    bool indexed_;                                  // Whether value_index_ is maintained
+    value_index value_index_;                       // Value -> leaf slot
+    std::vector<unsigned int> order_;               // Element tested at each level
+    std::vector<std::size_t> query_absent_counts_;  // Observed queries lacking each element
+    std::size_t observed_queries_{0};
+
+    void validate_capacity(const binary_set &bs) const {
+        if (capacity_ != bs.capacity()) {
+            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        }
+    }
+
+    // Takes a node from the free list, or appends one to the pool
+    [[nodiscard]]
+    std::uint32_t allocate() {
+        if (!free_nodes_.empty()) {
+            const std::uint32_t index = free_nodes_.back();
+            free_nodes_.pop_back();
+            return index;
+        }
+        if (nodes_.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The bs_searcher node pool is full.");
+        }
+        nodes_.emplace_back();
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    // Resets a childless node and returns it to the free list
+    void release(std::uint32_t index) {
+        dead_values_ += nodes_[index].value_capacity;
+        nodes_[index] = treenode{};
+        free_nodes_.push_back(index);
+    }
+
+    // Stores value under bs, regardless of the insert mode
+    void insert(const Value &value, const binary_set &bs) {
+        std::uint32_t leaf = 0;
+        std::vector<std::uint32_t> path;
+        path.reserve(capacity_);
+
+        // Traverse the tree according to the binary_set (present -> right,
+        // absent
+        // -> left)
+        const set_words words(bs);
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            path.push_back(leaf);
+            const bool present = words.holds(order_[i]);
+
+            std::uint32_t child = present ? nodes_[leaf].right : nodes_[leaf].left;
+            if (!child) {
+                child = allocate();  // May reallocate the pool: no references held across
+                (present ? nodes_[leaf].right : nodes_[leaf].left) = child;
+                nodes_[child].parent = leaf;
+            }
+            leaf = child;
+        }
+
+        // Store the value at the leaf
+        ++version_;
+        const std::uint32_t position = append_value(leaf, value);
+        if constexpr (indexable) {
+            if (indexed_) value_index_.emplace(value, leaf_slot{leaf, position});
+        }
+        refresh(leaf);
+        refresh_path(path);
+        compact_if_sparse();
+    }
+
+    // Values stored at a leaf
+    [[nodiscard]]
+    std::span<const Value> values_of(const treenode &leaf) const noexcept {
+        return {values_.data() + leaf.values_begin, leaf.value_count};
+    }
+
+    // Appends a value to a leaf's range and returns its position there. A
+    // full range grows in place at the end of the pool, or else moves there
+    // with twice the room, leaving its old slots dead. New slots are filled
+    // with copies of value, so Value needs no default constructor.
+    std::uint32_t append_value(std::uint32_t leaf, const Value &value) {
+        values_ordered_ = false;
+        treenode &node = nodes_[leaf];
+        if (node.value_count == node.value_capacity) {
+            const std::uint32_t room = std::max<std::uint32_t>(1, node.value_capacity);
+            if (values_.size() + room + node.value_capacity > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("The bs_searcher value pool is full.");
+            }
+
+            if (node.value_capacity > 0 && node.values_begin + node.value_capacity == values_.size()) {
+                values_.insert(values_.end(), room, value);
+            } else {
+                const auto begin = static_cast<std::uint32_t>(values_.size());
+                values_.insert(values_.end(), node.value_capacity + room, value);
+                std::move(values_.begin() + node.values_begin, values_.begin() + node.values_begin + node.value_count, values_.begin() + begin);
+                dead_values_ += node.value_capacity;
+                node.values_begin = begin;
+            }
+            node.value_capacity += room;
+        }
+
+        values_[node.values_begin + node.value_count] = value;
+        return node.value_count++;
+    }
+
+    // Compacts the value pool once more than half of it is dead
+    void compact_if_sparse() {
+        if (dead_values_ * 2 > values_.size()) compact_values();
+    }
+
+    // Rewrites the value pool with the leaf ranges packed in depth-first
+    // order, left subtrees first, so that neighbouring leaves are adjacent
+    void compact_values() {
+        std::vector<Value> compacted;
+        compacted.reserve(values_.size() - dead_values_);
+
+        std::vector<std::uint32_t> stack = {0};
+        while (!stack.empty()) {
+            treenode &node = nodes_[stack.back()];
+            stack.pop_back();
+
+            const auto begin = static_cast<std::uint32_t>(compacted.size());
+            std::move(values_.begin() + node.values_begin, values_.begin() + node.values_begin + node.value_count, std::back_inserter(compacted));
+            node.values_begin = node.value_count > 0 ? begin : 0;
+            node.value_capacity = node.value_count;
+
+            if (node.right) stack.push_back(node.right);
+            if (node.left) stack.push_back(node.left);
+        }
+
+        values_.swap(compacted);
+        dead_values_ = 0;
+        values_ordered_ = true;
+    }
+
+    // Index entry of the value stored at the given leaf slot
+    auto find_slot(const Value &value, std::uint32_t leaf, std::uint32_t position) {
+        auto [first, last] = value_index_.equal_range(value);
+        for (auto it = first; it != last; ++it) {
+            if (it->second.leaf == leaf && it->second.position == position) return it;
+        }
+        return value_index_.end();
+    }
+
+    // Removes the value at a leaf slot by swap-and-pop. Only if the leaf
+    // emptied is the path walked, to prune the branch and refresh the
+    // surviving summaries.
+    void erase_value(std::uint32_t leaf, std::size_t position) {
+        if (cache_.enabled()) cache_.drop(values_[nodes_[leaf].values_begin + position], set_of(leaf));
+
+        ++version_;
+        values_ordered_ = false;
+        treenode &node = nodes_[leaf];
+        Value *values = values_.data() + node.values_begin;
+        const std::size_t last = node.value_count - 1;
+        if constexpr (indexable) {
+            if (indexed_) {
+                value_index_.erase(find_slot(values[position], leaf, static_cast<std::uint32_t>(position)));
+                if (position != last) {
+                    find_slot(values[last], leaf, static_cast<std::uint32_t>(last))->second.position = static_cast<std::uint32_t>(position);
+                }
+            }
+        }
+        if (position != last) values[position] = std::move(values[last]);
+        --node.value_count;
+
+        // Prune empty branches from leaf to root
+        if (node.value_count == 0 && capacity_ > 0) {
+            // Recover the root-to-leaf path from the parent links
+            std::vector<std::uint32_t> path(capacity_);
+            std::uint32_t child = leaf;
+            for (unsigned int level = capacity_; level > 0; --level) {
+                child = nodes_[child].parent;
+                path[level - 1] = child;
+            }
+
+            std::size_t kept = path.size();
+            child = leaf;
+            for (std::size_t i = path.size(); i > 0; --i) {
+                treenode &parent = nodes_[path[i - 1]];
+                std::uint32_t &link = parent.right == child ? parent.right : parent.left;
+
+                release(link);
+                link = 0;
+                kept = i;
+                child = path[i - 1];
+
+                // Stop pruning if parent has other children
+                if (parent.left || parent.right) {
+                    break;
+                }
+            }
+
+            // The surviving ancestors lost a branch: their summaries may grow
+            path.resize(kept);
+            refresh_path(path);
+            compact_if_sparse();
+        }
+    }
+
+    // Copies the subtree rooted at node source of other into the pools, as
+    // the child of parent on the given side. Summaries do not depend on the
+    // depth, so they are copied as they are.
+    void adopt_subtree(const basic_bs_searcher &other, std::uint32_t source, std::uint32_t parent, bool right) {
+        struct frame {
+            std::uint32_t source;
+            std::uint32_t parent;
+            bool right;
+        };
+
+        values_ordered_ = false;
+        std::vector<frame> stack = {{source, parent, right}};
+        while (!stack.empty()) {
+            const frame top = stack.back();
+            stack.pop_back();
+
+            const treenode &from = other.nodes_[top.source];
+            if (values_.size() + from.value_count > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("The bs_searcher value pool is full.");
+            }
+            const std::uint32_t node = allocate();
+            treenode copy = from;
+            copy.left = 0;
+            copy.right = 0;
+            copy.parent = top.parent;
+            copy.values_begin = from.value_count > 0 ? static_cast<std::uint32_t>(values_.size()) : 0;
+            copy.value_capacity = from.value_count;
+            nodes_[node] = copy;
+            (top.right ? nodes_[top.parent].right : nodes_[top.parent].left) = node;
+
+            const std::span<const Value> values = other.values_of(from);
+            values_.insert(values_.end(), values.begin(), values.end());
+            if constexpr (indexable) {
+                if (indexed_) {
+                    for (std::uint32_t position = 0; position < values.size(); ++position) {
+                        value_index_.emplace(values[position], leaf_slot{node, position});
+                    }
+                }
+            }
+
+            if (from.right) stack.push_back({from.right, node, true});
+            if (from.left) stack.push_back({from.left, node, false});
+        }
+    }
+
+    // Rebuilds the stored set of a leaf from the parent links
+    [[nodiscard]]
+    binary_set set_of(std::uint32_t leaf) const {
+        binary_set bs = capacity_ > 0 ? binary_set(capacity_) : binary_set();
+        std::uint32_t child = leaf;
+        for (unsigned int level = capacity_; level > 0; --level) {
+            const std::uint32_t parent = nodes_[child].parent;
+            if (nodes_[parent].right == child) bs.add(order_[level - 1]);
+            child = parent;
+        }
+        return bs;
+    }
+
+    // Rebuilds the value index from the leaves
+    void reindex() {
+        value_index_.clear();
+        for (std::size_t index = 0; index < nodes_.size(); ++index) {
+            const std::span<const Value> values = values_of(nodes_[index]);
+            for (std::size_t position = 0; position < values.size(); ++position) {
+                value_index_.emplace(values[position], leaf_slot{static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(position)});
+            }
+        }
+    }
+
+    // Words per level-order key: bit 63 of word 0 is level 0, so that keys
+    // compare like the tree orders its leaves (left before right)
+    [[nodiscard]]
+    std::size_t key_words() const noexcept {
+        return (static_cast<std::size_t>(capacity_) + 63) / 64;
+    }
+
+    // Number of leading levels two keys have in common
+    [[nodiscard]]
+    unsigned int common_levels(const std::uint64_t *a, const std::uint64_t *b) const noexcept {
+        for (std::size_t w = 0; w < key_words(); ++w) {
+            const std::uint64_t diff = a[w] ^ b[w];
+            if (diff) return static_cast<unsigned int>(w * 64 + std::countl_zero(diff));
+        }
+        return capacity_;
+    }
+
+    // Sorts the entry indices in perm by their keys, by LSD radix sort on
+    // bytes. Stable, so equal sets keep their input order. Passes where every
+    // key has the same byte are skipped.
+    void radix_sort(const std::vector<std::uint64_t> &keys, std::span<std::size_t> perm) const {
+        const std::size_t words = key_words();
+        const std::size_t count = perm.size();
+        std::vector<std::size_t> scratch(count);
+        std::size_t *from = perm.data();
+        std::size_t *to = scratch.data();
+
+        for (std::size_t pass = 0; pass < words * 8; ++pass) {
+            const std::size_t word = words - 1 - pass / 8;
+            const unsigned int shift = static_cast<unsigned int>(pass % 8) * 8;
+            auto digit = [&](std::size_t entry) { return static_cast<std::size_t>((keys[entry * words + word] >> shift) & 0xFF); };
+
+            std::size_t buckets[257] = {};
+            for (std::size_t i = 0; i < count; ++i) ++buckets[digit(from[i]) + 1];
+            if (std::find(std::begin(buckets), std::end(buckets), count) != std::end(buckets)) continue;
+
+            for (std::size_t b = 1; b < 257; ++b) buckets[b] += buckets[b - 1];
+            for (std::size_t i = 0; i < count; ++i) to[buckets[digit(from[i])]++] = from[i];
+            std::swap(from, to);
+        }
+
+        if (from != perm.data()) std::copy_n(from, count, perm.data());
+    }
+
+    // Sets the bits of a level-order key: bit 63 - i % 64 of word i / 64 is level i
+    void encode_key(const binary_set &bs, std::uint64_t *key) const {
+        const set_words words(bs);
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            key[i / 64] |= std::uint64_t{words.holds(order_[i])} << (63 - i % 64);
+        }
+    }
+
+    // The set a level-order key encodes
+    [[nodiscard]]
+    binary_set decode_key(const std::uint64_t *key) const {
+        binary_set bs = capacity_ > 0 ? binary_set(capacity_) : binary_set();
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            if ((key[i / 64] >> (63 - i % 64)) & 1u) bs.add(order_[i]);
+        }
+        return bs;
+    }
+
+    // Builds bottom-up the subtree holding the entries in perm, sorted by key,
+    // which all share their first depth levels. Consecutive keys share their
+    // common prefix, so each node is appended exactly once, in depth-first
+    // order, and each leaf's values end up together.
+    [[nodiscard]]
+    arena build_subtree(const std::vector<std::uint64_t> &keys, std::span<const std::size_t> perm, const std::vector<Value> &values,
+                        unsigned int depth) const {
+        const std::size_t words = key_words();
+        auto key_of = [&](std::size_t k) { return keys.data() + perm[k] * words; };
+
+        // Every distinct key adds the levels below its common prefix with the previous one
+        std::size_t node_count = 1 + capacity_ - depth;
+        for (std::size_t k = 1; k < perm.size(); ++k) node_count += capacity_ - common_levels(key_of(k - 1), key_of(k));
+
+        arena out;
+        out.nodes.reserve(node_count);
+        out.nodes.emplace_back();
+        out.values.reserve(perm.size());
+
+        // path[d] is the node at depth d on the path of the previous key
+        std::vector<std::uint32_t> path(static_cast<std::size_t>(capacity_) + 1, 0);
+        for (std::size_t k = 0; k < perm.size(); ++k) {
+            const std::uint64_t *key = key_of(k);
+            unsigned int level = depth;
+            if (k > 0) {
+                level = common_levels(key_of(k - 1), key);
+                // Below the divergence, the previous key's subtrees are complete
+                for (unsigned int d = capacity_; d > level; --d) refresh(out.nodes, path[d]);
+            }
+
+            // Sorted order: at the divergence the previous key went left, this one goes right
+            for (unsigned int d = level; d < capacity_; ++d) {
+                const bool present = (key[d / 64] >> (63 - d % 64)) & 1u;
+                out.nodes.emplace_back();
+                const auto child = static_cast<std::uint32_t>(out.nodes.size() - 1);
+                (present ? out.nodes[path[d]].right : out.nodes[path[d]].left) = child;
+                out.nodes[child].parent = path[d];
+                path[d + 1] = child;
+            }
+            treenode &leaf = out.nodes[path[capacity_]];
+            if (leaf.value_count == 0) leaf.values_begin = static_cast<std::uint32_t>(out.values.size());
+            out.values.push_back(values[perm[k]]);
+            ++leaf.value_count;
+            ++leaf.value_capacity;
+        }
+
+        for (unsigned int d = capacity_ + 1; d > depth; --d) refresh(out.nodes, path[d - 1]);
+        return out;
+    }
+
+    // Replaces the tree with the given (value, set) entries, built bottom-up
+    // from their sorted level-order keys regardless of the insert mode
+    template <typename Range>
+    void build(const Range &entries) {
+        const std::size_t words = key_words();
+        std::vector<Value> values;
+        std::vector<std::uint64_t> keys;
+        for (const auto &[value, bs] : entries) {
+            values.push_back(value);
+            keys.resize(keys.size() + words, 0);
+            encode_key(bs, keys.data() + keys.size() - words);
+        }
+
+        clear();
+        if (values.empty()) return;
+
+        std::vector<std::size_t> perm(values.size());
+        for (std::size_t i = 0; i < perm.size(); ++i) perm[i] = i;
+        radix_sort(keys, perm);
+
+        arena built = build_subtree(keys, perm, values, 0);
+        nodes_ = std::move(built.nodes);
+        values_ = std::move(built.values);
+        if constexpr (indexable) {
+            if (indexed_) reindex();
+        }
+    }
+
+    // Moves a subtree built at depth parallel_prefix_levels into the pools, as
+    // the child of parent on the given side
+    void splice(arena &built, std::uint32_t parent, bool right) {
+        const std::size_t node_base = nodes_.size();
+        const std::size_t value_base = values_.size();
+        if (node_base + built.nodes.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The bs_searcher node pool is full.");
+        }
+        if (value_base + built.values.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("The bs_searcher value pool is full.");
+        }
+
+        values_ordered_ = false;
+        nodes_.reserve(node_base + built.nodes.size());
+        for (std::size_t j = 0; j < built.nodes.size(); ++j) {
+            treenode node = built.nodes[j];
+            if (node.left) node.left += static_cast<std::uint32_t>(node_base);
+            if (node.right) node.right += static_cast<std::uint32_t>(node_base);
+            node.parent = j == 0 ? parent : node.parent + static_cast<std::uint32_t>(node_base);
+            if (node.value_count > 0) node.values_begin += static_cast<std::uint32_t>(value_base);
+            nodes_.push_back(node);
+        }
+        (right ? nodes_[parent].right : nodes_[parent].left) = static_cast<std::uint32_t>(node_base);
+        values_.insert(values_.end(), std::make_move_iterator(built.values.begin()), std::make_move_iterator(built.values.end()));
+
+        if constexpr (indexable) {
+            if (indexed_) {
+                for (std::size_t j = 0; j < built.nodes.size(); ++j) {
+                    const auto leaf = static_cast<std::uint32_t>(node_base + j);
+                    for (std::uint32_t position = 0; position < nodes_[leaf].value_count; ++position) {
+                        value_index_.emplace(values_[nodes_[leaf].values_begin + position], leaf_slot{leaf, position});
+                    }
+                }
+            }
+        }
+    }
+
+    // The set holding every element, used as the upper bound of superset searches
+    [[nodiscard]]
+    binary_set full_set() const {
+        return capacity_ > 0 ? binary_set(capacity_, true) : binary_set();
+    }
+
+    // Depth-first search over the stored sets S with lower <= S <= upper (no
+    // lower bound if lower is null), pruned by the node summaries of both. Calls
+    // f(leaf, set) for each such leaf and stops as soon as f returns true.
+    // Returns whether the search was stopped.
+    template <typename F>
+    bool search_between(const level_query *lower, const level_query &upper, F &&f) const {
+        struct frame {
+            const treenode *node;
+            unsigned int depth;
+            bool is_right;
+        };
+
+        // Both bounds prune with the node summaries
+        auto fits = [lower, &upper](const treenode &node, unsigned int level) {
+            return upper.admits(node, level) && (!lower || lower->reachable(node, level));
+        };
+
+        if (!fits(nodes_[0], 0)) return false;
+
+        binary_set path = capacity_ > 0 ? binary_set(capacity_) : binary_set();
+        std::vector<frame> stack;
+        stack.push_back({nodes_.data(), 0, false});
+
+        while (!stack.empty()) {
+            const frame top = stack.back();
+            stack.pop_back();
+
+            // Ancestors already wrote levels [0, depth - 1); this frame owns depth - 1
+            if (top.depth > 0) {
+                if (top.is_right) {
+                    path.add(order_[top.depth - 1]);
+                } else {
+                    path.remove(order_[top.depth - 1]);
+                }
+            }
+
+            if (top.depth == capacity_) {
+                if (f(top.node, path)) return true;
+                continue;
+            }
+
+            // The lower bound forces right, the upper bound forces left
+            const unsigned int level = top.depth;
+            const treenode *left = top.node->left ? &nodes_[top.node->left] : nullptr;
+            const treenode *right = top.node->right ? &nodes_[top.node->right] : nullptr;
+            if (right && upper.present(level) && fits(*right, level + 1)) {
+                stack.push_back({right, level + 1, true});
+            }
+            if (left && !(lower && lower->present(level)) && fits(*left, level + 1)) {
+                stack.push_back({left, level + 1, false});
+            }
+        }
+
+        return false;
+    }
+
+    // Returns the leaf holding the sets equal to bs, or nullptr if none is stored
+    [[nodiscard]]
+    const treenode *leaf_of(const binary_set &bs) const {
+        const set_words words(bs);
+        std::uint32_t node = 0;
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            node = words.holds(order_[i]) ? nodes_[node].right : nodes_[node].left;
+            if (!node) return nullptr;
+        }
+        return &nodes_[node];
+    }
+
+    // Copies the values of the given leaves, in order, into one vector
+    [[nodiscard]]
+    std::vector<Value> collect_values(const std::vector<const treenode *> &leaves) const {
+        std::vector<value_run> runs;
+        runs.reserve(leaves.size());
+        for (const auto *node : leaves) append_run(runs, {node->values_begin, node->values_begin + node->value_count});
+        return collect_runs(runs);
+    }
+
+    // Appends a run of the value pool, merged into the last one if adjacent
+    static void append_run(std::vector<value_run> &runs, value_run run) {
+        if (run.begin == run.end) return;
+        if (!runs.empty() && runs.back().end == run.begin) {
+            runs.back().end = run.end;
+        } else {
+            runs.push_back(run);
+        }
+    }
+
+    // Copies the given runs of the value pool, in order, into one vector
+    [[nodiscard]]
+    std::vector<Value> collect_runs(const std::vector<value_run> &runs) const {
+        std::size_t total_values = 0;
+        for (const value_run &run : runs) total_values += run.end - run.begin;
+
+        std::vector<Value> result;
+        if constexpr (std::is_trivially_copyable_v<Value> && std::is_default_constructible_v<Value>) {
+            // One allocation, then a raw copy per run
+            result.resize(total_values);
+            Value *out = result.data();
+            for (const value_run &run : runs) {
+                std::memcpy(out, values_.data() + run.begin, (run.end - run.begin) * sizeof(Value));
+                out += run.end - run.begin;
+            }
+        } else {
+            result.reserve(total_values);
+            for (const value_run &run : runs) result.insert(result.end(), values_.begin() + run.begin, values_.begin() + run.end);
+        }
+
+        return result;
+    }
+
+    // Calls visit(run) on the runs of the value pool holding the values of all
+    // stored subsets of the query, left to right, adjacent runs merged. Once
+    // the rest of the query holds every element, every set below a frontier
+    // node matches: the level-by-level traversal stops there and each node's
+    // subtree is taken whole, as one run while values_ordered_ holds, else
+    // leaf by leaf without testing the summaries, on one stack shared by all
+    // of them.
+    template <typename Visit>
+    void for_each_subset_run(const level_query &query, Visit &&visit) const {
+        value_run pending{0, 0};
+        auto emit = [&pending, &visit](value_run run) {
+            if (run.begin == run.end) return;
+            if (pending.end == run.begin) {
+                pending.end = run.end;
+                return;
+            }
+            if (pending.begin != pending.end) visit(pending);
+            pending = run;
+        };
+
+        std::vector<const treenode *> stack;
+        for (const auto *node : matching_frontier(query, query.ones_from(), nullptr)) {
+            if (values_ordered_) {
+                // The subtree's leaves are adjacent: one run from the leftmost to the rightmost
+                const treenode *first = node;
+                while (first->left || first->right) first = &nodes_[first->left ? first->left : first->right];
+                const treenode *last = node;
+                while (last->left || last->right) last = &nodes_[last->right ? last->right : last->left];
+                emit({first->values_begin, last->values_begin + last->value_count});
+                continue;
+            }
+
+            stack.push_back(node);
+            while (!stack.empty()) {
+                const treenode *top = stack.back();
+                stack.pop_back();
+                if (!top->left && !top->right) {
+                    emit({top->values_begin, top->values_begin + top->value_count});
+                    continue;
+                }
+                if (top->right) stack.push_back(&nodes_[top->right]);
+                if (top->left) stack.push_back(&nodes_[top->left]);
+            }
+        }
+        if (pending.begin != pending.end) visit(pending);
+    }
+
+    // Runs of the value pool holding the values of all stored subsets of bs
+    [[nodiscard]]
+    std::vector<value_run> subset_runs(const binary_set &bs) const {
+        std::vector<value_run> runs;
+        for_each_subset_run(level_query(bs, order_), [&runs](value_run run) { runs.push_back(run); });
+        return runs;
+    }
+
+    // Returns the leaves of all stored subsets of bs, optionally counting the
+    // nodes visited on the way
+    [[nodiscard]]
+    std::vector<const treenode *> matching_leaves(const binary_set &bs, std::size_t *visited) const {
+        return matching_frontier(level_query(bs, order_), capacity_, visited);
+    }
+
+    // Returns the nodes at the given depth whose subtrees may hold subsets of
+    // the query, in left-to-right order, optionally counting the nodes
+    // visited on the way
+    [[nodiscard]]
+    std::vector<const treenode *> matching_frontier(const level_query &query, unsigned int depth, std::size_t *visited) const {
+
+        // Use two vectors for level-by-level tree traversal
+        std::vector<const treenode *> current_level;
+        std::vector<const treenode *> next_level;
+        current_level.reserve(capacity_);
+        next_level.reserve(capacity_ * 2);
+
+        if (query.admits(nodes_[0], 0)) current_level.push_back(nodes_.data());
+
+        // Traverse the tree level by level, skipping children whose summaries
+        // rule out every set below them
+        for (unsigned int i = 0; i < depth && !current_level.empty(); ++i) {
+            if (visited) *visited += current_level.size();
+            next_level.clear();
+            const bool present = query.present(i);
+
+            for (const auto *node : current_level) {
+                if (present) {
+                    // If element is in query set, a subset could have it or not
+                    if (node->left && query.admits(nodes_[node->left], i + 1)) next_level.push_back(&nodes_[node->left]);
+                    if (node->right && query.admits(nodes_[node->right], i + 1)) next_level.push_back(&nodes_[node->right]);
+                } else {
+                    // If element is not in query set, subset must not have it
+                    // either
+                    if (node->left && query.admits(nodes_[node->left], i + 1)) next_level.push_back(&nodes_[node->left]);
+                }
+            }
+
+            current_level.swap(next_level);
+        }
+
+        if (visited) *visited += current_level.size();
+        return current_level;
+    }
+
+    // Returns the leaves holding sets with at most k elements outside bs,
+    // tracking the violations used along each path
+    [[nodiscard]]
+    std::vector<const treenode *> near_leaves(const binary_set &bs, unsigned int k) const {
+        const level_query query(bs, order_);
+
+        struct entry {
+            const treenode *node;
+            unsigned int used;  // Present branches taken on elements absent from bs
+        };
+
+        std::vector<entry> current_level;
+        std::vector<entry> next_level;
+        if (query.violations(nodes_[0], 0) <= k) current_level.push_back({nodes_.data(), 0});
+
+        for (unsigned int i = 0; i < capacity_ && !current_level.empty(); ++i) {
+            next_level.clear();
+            const unsigned int cost = query.present(i) ? 0 : 1;
+
+            for (const entry &e : current_level) {
+                if (e.node->left && query.violations(nodes_[e.node->left], i + 1) <= k - e.used) {
+                    next_level.push_back({&nodes_[e.node->left], e.used});
+                }
+                const unsigned int used = e.used + cost;
+                if (e.node->right && used <= k && query.violations(nodes_[e.node->right], i + 1) <= k - used) {
+                    next_level.push_back({&nodes_[e.node->right], used});
+                }
+            }
+
+            current_level.swap(next_level);
+        }
+
+        std::vector<const treenode *> leaves;
+        leaves.reserve(current_level.size());
+        for (const entry &e : current_level) leaves.push_back(e.node);
+        return leaves;
+    }
+
+    // Returns the leaves holding sets that share at least t elements with bs,
+    // tracking the overlap along each path
+    [[nodiscard]]
+    std::vector<const treenode *> overlap_leaves(const binary_set &bs, unsigned int t) const {
+        const level_query query(bs, order_);
+
+        struct entry {
+            const treenode *node;
+            unsigned int overlap;  // Present branches taken on query elements
+        };
+
+        // Stored sets exist below a node, and the best of them can still reach t
+        auto reaches = [&](const treenode &node, unsigned int level, unsigned int overlap) {
+            return node.min_remaining <= node.max_remaining && overlap + query.max_overlap(node, level) >= t;
+        };
+
+        std::vector<entry> current_level;
+        std::vector<entry> next_level;
+        if (reaches(nodes_[0], 0, 0)) current_level.push_back({nodes_.data(), 0});
+
+        for (unsigned int i = 0; i < capacity_ && !current_level.empty(); ++i) {
+            next_level.clear();
+            const unsigned int gain = query.present(i) ? 1 : 0;
+
+            for (const entry &e : current_level) {
+                if (e.node->left && reaches(nodes_[e.node->left], i + 1, e.overlap)) next_level.push_back({&nodes_[e.node->left], e.overlap});
+                if (e.node->right && reaches(nodes_[e.node->right], i + 1, e.overlap + gain)) {
+                    next_level.push_back({&nodes_[e.node->right], e.overlap + gain});
+                }
+            }
+
+            current_level.swap(next_level);
+        }
+
+        std::vector<const treenode *> leaves;
+        leaves.reserve(current_level.size());
+        for (const entry &e : current_level) leaves.push_back(e.node);
+        return leaves;
+    }
+
+    // Returns the leaves holding subsets of bs with min_size to max_size
+    // elements, tracking the elements taken along each path
+    [[nodiscard]]
+    std::vector<const treenode *> sized_leaves(const binary_set &bs, unsigned int min_size, unsigned int max_size) const {
+        const level_query query(bs, order_);
+
+        struct entry {
+            const treenode *node;
+            unsigned int taken;  // Right edges on the path to node
+        };
+
+        // A node can hold a match if it fits in the query and the sizes of the
+        // sets below it can still meet the range
+        auto fits = [&](const treenode &node, unsigned int level, unsigned int taken) {
+            return query.admits(node, level) && node.min_remaining <= max_size - taken &&
+                   taken + std::min(node.max_remaining, query.remaining(level)) >= min_size;
+        };
+
+        std::vector<entry> current_level;
+        std::vector<entry> next_level;
+        if (min_size <= max_size && fits(nodes_[0], 0, 0)) current_level.push_back({nodes_.data(), 0});
+
+        for (unsigned int i = 0; i < capacity_ && !current_level.empty(); ++i) {
+            next_level.clear();
+            const bool present = query.present(i);
+
+            for (const entry &e : current_level) {
+                if (e.node->left && fits(nodes_[e.node->left], i + 1, e.taken)) next_level.push_back({&nodes_[e.node->left], e.taken});
+                if (present && e.node->right && e.taken < max_size && fits(nodes_[e.node->right], i + 1, e.taken + 1)) {
+                    next_level.push_back({&nodes_[e.node->right], e.taken + 1});
+                }
+            }
+
+            current_level.swap(next_level);
+        }
+
+        std::vector<const treenode *> leaves;
+        leaves.reserve(current_level.size());
+        for (const entry &e : current_level) leaves.push_back(e.node);
+        return leaves;
+    }
+
+    // Recomputes the summary of a node from its children
+    void refresh(std::uint32_t index) noexcept {
+        refresh(nodes_, index);
+    }
+
+    // Same, for a node of a subtree being built apart from the pool
+    static void refresh(std::vector<treenode> &nodes, std::uint32_t index) noexcept {
+        treenode &node = nodes[index];
+        if (!node.left && !node.right) {
+            node.min_remaining = 0;
+            node.max_remaining = 0;
+            node.required = 0;
+            node.possible = 0;
+            return;
+        }
+
+        node.min_remaining = std::numeric_limits<unsigned int>::max();
+        node.max_remaining = 0;
+        node.required = ~std::uint64_t{0};
+        node.possible = 0;
+        if (node.left) {
+            node.min_remaining = nodes[node.left].min_remaining;
+            node.max_remaining = nodes[node.left].max_remaining;
+            node.required &= nodes[node.left].required << 1;
+            node.possible |= nodes[node.left].possible << 1;
+        }
+        if (node.right) {
+            node.min_remaining = std::min(node.min_remaining, nodes[node.right].min_remaining + 1);
+            node.max_remaining = std::max(node.max_remaining, nodes[node.right].max_remaining + 1);
+            node.required &= (nodes[node.right].required << 1) | 1u;
+            node.possible |= (nodes[node.right].possible << 1) | 1u;
+        }
+    }
+
+    // Refreshes the summaries along a root-to-node path, bottom-up, stopping
+    // as soon as a summary is unchanged since the ancestors then are too
+    void refresh_path(const std::vector<std::uint32_t> &path) noexcept {
+        for (std::size_t i = path.size(); i > 0; --i) {
+            const treenode &node = nodes_[path[i - 1]];
+            const unsigned int old_min = node.min_remaining;
+            const unsigned int old_max = node.max_remaining;
+            const std::uint64_t old_required = node.required;
+            const std::uint64_t old_possible = node.possible;
+            refresh(path[i - 1]);
+            if (node.min_remaining == old_min && node.max_remaining == old_max && node.required == old_required &&
+                node.possible == old_possible) {
+                break;
+            }
+        }
+    }
+
+    // Lays the tree out in depth-first order, left subtrees first
+    void flatten(std::vector<flat_node> &nodes, std::vector<unsigned int> &values) const {
+        struct frame {
+            const treenode *node;
+            std::size_t parent;
+            bool is_right;
+        };
+
+        std::vector<frame> stack;
+        stack.push_back({nodes_.data(), 0, false});
+
+        while (!stack.empty()) {
+            const frame top = stack.back();
+            stack.pop_back();
+
+            const std::size_t index = nodes.size();
+            if (index > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error("Too many nodes for the snapshot format.");
+            }
+            flat_node flat{};
+            flat.required = top.node->required;
+            flat.values_begin = values.size();
+            flat.min_remaining = top.node->min_remaining;
+            flat.value_count = top.node->value_count;
+            nodes.push_back(flat);
+            const std::span<const Value> node_values = values_of(*top.node);
+            values.insert(values.end(), node_values.begin(), node_values.end());
+
+            if (index > 0) {
+                if (top.is_right) {
+                    nodes[top.parent].right = static_cast<std::uint32_t>(index);
+                } else {
+                    nodes[top.parent].left = static_cast<std::uint32_t>(index);
+                }
+            }
+
+            if (top.node->right) stack.push_back({&nodes_[top.node->right], index, true});
+            if (top.node->left) stack.push_back({&nodes_[top.node->left], index, false});
+        }
+    }
+
+    // Calls f(value, set) for every stored value, rebuilding each set from its
+    // root-to-leaf path
+    template <typename F>
+    void for_each_entry(F &&f) const {
+        const level_query full(full_set(), order_);
+        search_between(nullptr, full, [this, &f](const treenode *leaf, const binary_set &path) {
+            for (const Value &value : values_of(*leaf)) f(value, path);
+            return false;
+        });
+    }
+};
+
+/// Searcher storing unsigned int identifiers
+using bs_searcher = basic_bs_searcher<>;
+
+/**
+ * @brief Read-only searcher backed by a snapshot written with bs_searcher::save().
+ *
+ * On POSIX systems the snapshot is memory-mapped: the value array is loaded
+ * on demand, and processes opening the same file share its pages. Elsewhere
+ * the file is read into memory in a single pass.
+ *
+ * Opening a snapshot validates every index that queries follow: the element
+ * order must be a permutation, child links must form a tree laid out in
+ * depth-first order, and leaf ranges must lie within the value array. This
+ * costs one pass over the nodes, and a corrupted or truncated file is
+ * refused instead of being read out of bounds. The file must still come
+ * from a machine with the same byte order: a foreign one is refused or
+ * yields wrong results.
+ *
+ * Example:
+ * @code
+ * searcher.save("sets.snap");
+ * bs_searcher_view view("sets.snap");
+ * auto results = view.find_subsets(query);
+ * @endcode
+ */
+class bs_searcher_view {
+   public:
+    /**
+     * @brief Opens a snapshot file.
+     *
+     * @param path Snapshot written by bs_searcher::save()
+     *
+     * @throw std::runtime_error If the file cannot be read or is not a valid
+     * snapshot
+     */
+    explicit bs_searcher_view(const std::string &path) {
+        load(path);
+        try {
+            parse();
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    bs_searcher_view(const bs_searcher_view &) = delete;
+    bs_searcher_view &operator=(const bs_searcher_view &) = delete;
+
+    bs_searcher_view(bs_searcher_view &&other) noexcept { swap(other); }
+
+    bs_searcher_view &operator=(bs_searcher_view &&other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~bs_searcher_view() { release(); }
+
+    /**
+     * @brief Returns the capacity of the sets in the snapshot.
+     *
+     * @return The capacity that query binary_sets must have
+     */
+    [[nodiscard]]
+    unsigned int capacity() const noexcept {
+        return capacity_;
+    }
+
+    /**
+     * @brief Returns the number of values stored in the snapshot.
+     *
+     * @return Number of stored values
+     */
+    [[nodiscard]]
+    std::size_t size() const noexcept {
+        return value_count_;
+    }
+
+    /**
+     * @brief Finds all stored sets that are subsets of the query set.
+     *
+     * Same traversal and pruning as bs_searcher::find_subsets().
+     *
+     * @param bs The query binary_set
+     * @return std::vector<unsigned int> Identifiers of all stored sets that are
+     * subsets of bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than the
+     * snapshot
+     */
+    [[nodiscard]]
+    std::vector<unsigned int> find_subsets(const binary_set &bs) const {
+        if (capacity_ != bs.capacity()) {
+            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        }
+
+        const bs_searcher::level_query query(bs, order_);
+
+        std::vector<std::uint32_t> current_level;
+        std::vector<std::uint32_t> next_level;
+        if (query.admits(nodes_[0], 0)) current_level.push_back(0);
+
+        for (unsigned int i = 0; i < capacity_ && !current_level.empty(); ++i) {
+            next_level.clear();
+            const bool present = query.present(i);
+
+            for (std::uint32_t index : current_level) {
+                const auto &node = nodes_[index];
+                if (node.left && query.admits(nodes_[node.left], i + 1)) next_level.push_back(node.left);
+                if (present && node.right && query.admits(nodes_[node.right], i + 1)) next_level.push_back(node.right);
+            }
+
+            current_level.swap(next_level);
+        }
+
+        std::size_t total_values = 0;
+        for (std::uint32_t index : current_level) {
+            total_values += nodes_[index].value_count;
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(total_values);
+        for (std::uint32_t index : current_level) {
+            const auto &node = nodes_[index];
+            result.insert(result.end(), values_ + node.values_begin, values_ + node.values_begin + node.value_count);
+        }
+
+        return result;
+    }
+
+   private:
+    const unsigned char *data_{nullptr};
+    std::size_t mapped_size_{0};       // Non-zero when data_ is a memory mapping
+    std::vector<unsigned char> buffer_;  // Holds the file when it is not mapped
+    unsigned int capacity_{0};
+    std::vector<unsigned int> order_;
+    const bs_searcher::flat_node *nodes_{nullptr};
+    const unsigned int *values_{nullptr};
+    std::size_t value_count_{0};
+
+    [[nodiscard]]
+    std::size_t buffer_size() const noexcept {
+        return mapped_size_ != 0 ? mapped_size_ : buffer_.size();
+    }
+
+    // Validates the header and every index queries follow, then points the
+    // accessors into the file
+    void parse() {
+        const std::size_t size = buffer_size();
+        if (size < sizeof(bs_searcher::snapshot_header)) throw std::runtime_error("The file is too small to be a snapshot.");
+
+        bs_searcher::snapshot_header header;
+        std::memcpy(&header, data_, sizeof header);
+        if (std::memcmp(header.magic, bs_searcher::SNAPSHOT_MAGIC, sizeof header.magic) != 0 ||
+            header.version != bs_searcher::SNAPSHOT_VERSION) {
+            throw std::runtime_error("The file is not a supported snapshot.");
+        }
+
+        // Bound the counts by the file size before the layout arithmetic can overflow
+        if (header.node_count == 0 || header.node_count > size / sizeof(bs_searcher::flat_node) ||
+            header.value_count > size / sizeof(std::uint32_t) || header.capacity > size / sizeof(std::uint32_t)) {
+            throw std::runtime_error("The snapshot is truncated or corrupted.");
+        }
+        const bs_searcher::snapshot_layout layout(header.capacity, header.node_count, header.value_count);
+        if (layout.total_size != size) throw std::runtime_error("The snapshot is truncated or corrupted.");
+
+        capacity_ = header.capacity;
+        const auto *order = reinterpret_cast<const unsigned int *>(data_ + layout.order_offset);
+        order_.assign(order, order + capacity_);
+        nodes_ = reinterpret_cast<const bs_searcher::flat_node *>(data_ + layout.nodes_offset);
+        values_ = reinterpret_cast<const unsigned int *>(data_ + layout.values_offset);
+        value_count_ = header.value_count;
+
+        std::vector<bool> seen(capacity_, false);
+        for (unsigned int element : order_) {
+            if (element >= capacity_ || seen[element]) throw std::runtime_error("The snapshot element order is corrupted.");
+            seen[element] = true;
+        }
+
+        // Children follow their parent in depth-first order and have one
+        // parent each, so the links form a tree and traversals terminate
+        std::vector<bool> linked(header.node_count, false);
+        for (std::uint64_t i = 0; i < header.node_count; ++i) {
+            const bs_searcher::flat_node &node = nodes_[i];
+            for (std::uint32_t child : {node.left, node.right}) {
+                if (child == 0) continue;
+                if (child <= i || child >= header.node_count || linked[child]) {
+                    throw std::runtime_error("The snapshot tree links are corrupted.");
+                }
+                linked[child] = true;
+            }
+            if (node.values_begin > header.value_count || node.value_count > header.value_count - node.values_begin) {
+                throw std::runtime_error("The snapshot value ranges are corrupted.");
+            }
+        }
+    }
+
+    void load(const std::string &path) {
+#if BINARY_SET_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open the snapshot file.");
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read the snapshot file.");
+        }
+
+        void *address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);  // The mapping stays valid after closing the descriptor
+        if (address == MAP_FAILED) throw std::runtime_error("Cannot map the snapshot file.");
+
+        data_ = static_cast<const unsigned char *>(address);
+        mapped_size_ = static_cast<std::size_t>(info.st_size);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) throw std::runtime_error("Cannot open the snapshot file.");
+
+        buffer_.resize(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char *>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        if (!in) throw std::runtime_error("Cannot read the snapshot file.");
+        data_ = buffer_.data();
+#endif
+    }
+
+    void release() noexcept {
+#if BINARY_SET_HAS_MMAP
+        if (mapped_size_ != 0) ::munmap(const_cast<unsigned char *>(data_), mapped_size_);
+#endif
+        data_ = nullptr;
+        mapped_size_ = 0;
+        buffer_.clear();
+    }
+
+    void swap(bs_searcher_view &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(mapped_size_, other.mapped_size_);
+        buffer_.swap(other.buffer_);
+        std::swap(capacity_, other.capacity_);
+        order_.swap(other.order_);
+        std::swap(nodes_, other.nodes_);
+        std::swap(values_, other.values_);
+        std::swap(value_count_, other.value_count_);
+    }
+};
+
+/**
+ * @brief Bitmap-based alternative to bs_searcher for large, sparse collections.
+ *
+ * Every stored set occupies a slot. For each element, a posting bitmap records
+ * the slots whose set contains that element. A stored set S is a subset of a
+ * query Q exactly when S holds no element outside Q, so find_subsets(Q) is the
+ * complement of the union of the postings of the elements missing from Q,
+ * restricted to the occupied slots.
+ *
+ * The bitmap kernels operate on 64-bit words in plain loops which compilers
+ * auto-vectorize, so no platform-specific intrinsics are required.
+ *
+ * Time complexity (N = number of slots):
+ * - add: O(capacity) amortized
+ * - remove: O(capacity) per stored set sharing the same value
+ * - find_subsets: O((capacity - |Q|) * N / 64 + matches)
+ *
+ * Example:
+ * @code
+ * bs_bitmap_searcher searcher(10);
+ * binary_set bs1(10);
+ * bs1.add(1); bs1.add(3);
+ * searcher.add(101, bs1);
+ *
+ * binary_set query(10);
+ * query.add(1); query.add(3); query.add(5);
+ * auto results = searcher.find_subsets(query);  // Returns {101}
+ * @endcode
+ */
+class bs_bitmap_searcher {
+   public:
+    /**
+     * @brief Constructs a searcher for binary_sets with the specified capacity.
+     *
+     * @param capacity The capacity that all managed binary_sets must have
+     */
+    explicit bs_bitmap_searcher(unsigned int capacity) : capacity_(capacity) {}
+
+    /**
+     * @brief Adds a binary_set to the search structure.
+     *
+     * Multiple sets with the same value or structure can be added.
+     *
+     * @param value Identifier/alias for this set (need not be unique)
+     * @param bs The binary_set to add
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    void add(unsigned int value, const binary_set &bs) {
+        validate_capacity(bs);
+
+        // Reuse a freed slot if possible, otherwise append a new one
+        std::size_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+            slot_values_[slot] = value;
+        } else {
+            slot = slot_values_.size();
+            if (slot == stride_ * 64) grow();
+            slot_values_.push_back(value);
+        }
+
+        set_bit(live_.data(), slot);
+        for_each_element(bs, [this, slot](unsigned int i) { set_bit(posting(i), slot); });
+        slots_by_value_.emplace(value, slot);
+    }
+
+    /**
+     * @brief Removes a binary_set from the search structure.
+     *
+     * If duplicates exist, only one occurrence is removed.
+     *
+     * @param value The identifier of the set to remove
+     * @param bs The binary_set to remove
+     * @return true if a matching set was found and removed
+     * @return false if no matching set was found
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    bool remove(unsigned int value, const binary_set &bs) {
+        validate_capacity(bs);
+
+        auto [first, last] = slots_by_value_.equal_range(value);
+        for (auto it = first; it != last; ++it) {
+            const std::size_t slot = it->second;
+            if (!slot_holds(slot, bs)) continue;
+
+            // Clear the slot everywhere so that it can be reused as-is
+            clear_bit(live_.data(), slot);
+            for_each_element(bs, [this, slot](unsigned int i) { clear_bit(posting(i), slot); });
+            slots_by_value_.erase(it);
+            free_slots_.push_back(slot);
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Finds all stored sets that are subsets of the query set.
+     *
+     * A stored set S is a subset of query set Q if every element in S is also
+     * in Q.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<unsigned int> Identifiers of all stored sets that are
+     * subsets of bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<unsigned int> find_subsets(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        // Union of the postings of every element missing from the query
+        std::vector<std::uint64_t> excluded(stride_, 0);
+        for (std::size_t w = 0; w < bs.word_count(); ++w) {
+            std::uint64_t missing = ~bs.word(w);
+            if ((w + 1) * 64 > capacity_) missing &= (std::uint64_t{1} << (capacity_ % 64)) - 1;
+            for (; missing; missing &= missing - 1) {
+                or_into(excluded.data(), posting(static_cast<unsigned int>(w * 64 + std::countr_zero(missing))), stride_);
+            }
+        }
+
+        // Every live slot outside the union is a match
+        std::vector<unsigned int> result;
+        for (std::size_t w = 0; w < stride_; ++w) {
+            std::uint64_t bits = live_[w] & ~excluded[w];
+            while (bits) {
+                result.push_back(slot_values_[w * 64 + std::countr_zero(bits)]);
+                bits &= bits - 1;
+            }
+        }
+
+        return result;
+    }
+
+   private:
+    unsigned int capacity_;
+    std::size_t stride_{0};                   // Words per posting bitmap
+    std::vector<std::uint64_t> postings_;     // capacity_ rows of stride_ words
+    std::vector<std::uint64_t> live_;         // Occupied slots
+    std::vector<unsigned int> slot_values_;   // Value stored in each slot
+    std::vector<std::size_t> free_slots_;     // Slots freed by remove()
+    std::unordered_multimap<unsigned int, std::size_t> slots_by_value_;
+
+    void validate_capacity(const binary_set &bs) const {
+        if (capacity_ != bs.capacity()) {
+            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        }
+    }
+
+    [[nodiscard]]
+    std::uint64_t *posting(unsigned int element) noexcept {
+        return postings_.data() + element * stride_;
+    }
+
+    [[nodiscard]]
+    const std::uint64_t *posting(unsigned int element) const noexcept {
+        return postings_.data() + element * stride_;
+    }
+
+    // Doubles the number of words per posting, keeping the existing rows
+    void grow() {
+        const std::size_t new_stride = stride_ == 0 ? 1 : stride_ * 2;
+        std::vector<std::uint64_t> grown(static_cast<std::size_t>(capacity_) * new_stride, 0);
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            std::copy_n(posting(i), stride_, grown.data() + i * new_stride);
+        }
+        postings_.swap(grown);
+        live_.resize(new_stride, 0);
+        stride_ = new_stride;
+    }
+
+    // Checks whether slot holds exactly the elements of bs
+    [[nodiscard]]
+    bool slot_holds(std::size_t slot, const binary_set &bs) const {
+        std::uint64_t word = 0;
+        for (unsigned int i = 0; i < capacity_; ++i) {
+            if (i % 64 == 0) word = bs.word(i / 64);
+            if (test_bit(posting(i), slot) != (((word >> (i % 64)) & 1u) != 0)) return false;
+        }
+        return true;
+    }
+
+    // Calls f(i) for every element i of bs, decoded from its raw words
+    template <typename F>
+    static void for_each_element(const binary_set &bs, F &&f) {
+        for (std::size_t w = 0; w < bs.word_count(); ++w) {
+            for (std::uint64_t bits = bs.word(w); bits; bits &= bits - 1) {
+                f(static_cast<unsigned int>(w * 64 + std::countr_zero(bits)));
+            }
+        }
+    }
+
+    // Bitmap kernels
+
+    static void or_into(std::uint64_t *dst, const std::uint64_t *src, std::size_t words) noexcept {
+        for (std::size_t i = 0; i < words; ++i) {
+            dst[i] |= src[i];
+        }
+    }
+
+    static void set_bit(std::uint64_t *bitmap, std::size_t bit) noexcept { bitmap[bit / 64] |= std::uint64_t{1} << (bit % 64); }
+
+    static void clear_bit(std::uint64_t *bitmap, std::size_t bit) noexcept { bitmap[bit / 64] &= ~(std::uint64_t{1} << (bit % 64)); }
+
+    [[nodiscard]]
+    static bool test_bit(const std::uint64_t *bitmap, std::size_t bit) noexcept {
+        return (bitmap[bit / 64] >> (bit % 64)) & 1u;
+    }
+};
+
+/**
+ * @brief Subset search engine split into independent bs_searcher shards.
+ *
+ * Stored sets are partitioned by their first prefix_bits elements into
+ * 2^prefix_bits shards, each a basic_bs_searcher with its own node and value
+ * pools and its own reader/writer lock. A stored set can only be a subset of
+ * a query if its prefix is a submask of the query's prefix, so find_subsets()
+ * visits just those shards: a query holding j of the prefix elements skips
+ * all but 2^j of them.
+ *
+ * Smaller trees keep each query's working set compact, and writers only lock
+ * the shard they touch, so adds to different shards and queries proceed
+ * concurrently. find_subsets() can also spread the visited shards over
+ * several threads.
+ *
+ * Time complexity (per shard, as in bs_searcher):
+ * - add: O(capacity)
+ * - remove: O(capacity)
+ * - find_subsets: O(capacity * number_of_matching_paths) over the visited shards
+ *
+ * Example:
+ * @code
+ * bs_sharded_searcher searcher(10, 2);  // 4 shards keyed on elements 0 and 1
+ * binary_set bs1(10);
+ * bs1.add(1); bs1.add(3);
+ * searcher.add(101, bs1);
+ *
+ * binary_set query(10);
+ * query.add(1); query.add(3); query.add(5);
+ * auto results = searcher.find_subsets(query, 4);  // Returns {101}, using up to 4 threads
+ * @endcode
+ *
+ * @tparam Value Payload stored with each set
+ */
+template <typename Value = unsigned int>
+class basic_bs_sharded_searcher {
+   public:
+    /// Largest supported number of prefix bits (65536 shards)
+    static constexpr unsigned int max_prefix_bits = 16;
+
+    /// Stored values searched per extra thread by find_subsets(bs, thread_count)
+    static constexpr std::size_t values_per_query_thread = std::size_t{1} << 14;
+
+    /**
+     * @brief Constructs a sharded searcher for binary_sets with the specified
+     * capacity.
+     *
+     * @param capacity The capacity that all managed binary_sets must have
+     * @param prefix_bits Number of leading elements keying the shards
+     *
+     * @throw std::invalid_argument If prefix_bits exceeds capacity or
+     * max_prefix_bits
+     */
+    basic_bs_sharded_searcher(unsigned int capacity, unsigned int prefix_bits) : capacity_(capacity), prefix_bits_(prefix_bits) {
+        if (prefix_bits > capacity || prefix_bits > max_prefix_bits) {
+            throw std::invalid_argument("The shard prefix must fit in the capacity and in max_prefix_bits.");
+        }
+        for (std::size_t i = 0; i < shard_count(); ++i) shards_.emplace_back(capacity);
+    }
+
+    /**
+     * @brief Adds a binary_set to the shard of its prefix.
+     *
+     * Multiple sets with the same value or structure can be added.
+     *
+     * @param value Identifier/alias for this set (need not be unique)
+     * @param bs The binary_set to add
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    void add(const Value &value, const binary_set &bs) {
+        validate_capacity(bs);
+
+        shard &target = shards_[prefix_of(bs)];
+        std::unique_lock lock(target.mutex);
+        if (target.searcher.add(value, bs)) target.size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Removes a binary_set from the shard of its prefix.
+     *
+     * If duplicates exist, only the first occurrence is removed.
+     *
+     * @param value The identifier of the set to remove
+     * @param bs The binary_set to remove
+     * @return true if a matching set was found and removed
+     * @return false if no matching set was found
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    bool remove(const Value &value, const binary_set &bs) {
+        validate_capacity(bs);
+
+        shard &target = shards_[prefix_of(bs)];
+        std::unique_lock lock(target.mutex);
+        const bool removed = target.searcher.remove(value, bs);
+        if (removed) target.size.fetch_sub(1, std::memory_order_relaxed);
+        return removed;
+    }
+
+    /**
+     * @brief Finds all stored sets that are subsets of the query set.
+     *
+     * Only the shards whose prefix is a submask of the query's prefix are
+     * searched.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<Value> Identifiers of all stored sets that are
+     * subsets of bs, grouped by shard
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<Value> find_subsets(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        return gather(bs, shards_under(bs), 0, 1);
+    }
+
+    /**
+     * @brief Finds all stored sets that are subsets of the query set,
+     * searching the shards on several threads.
+     *
+     * The shards to visit are dealt round-robin to the threads; the calling
+     * thread takes one share itself. Threads are started per call, so one
+     * extra thread is only started per values_per_query_thread values stored
+     * in those shards: small queries run on the calling thread alone. The
+     * results match find_subsets(bs), up to their order.
+     *
+     * @param bs The query binary_set
+     * @param thread_count Maximum number of threads, 0 for one per hardware
+     * thread
+     * @return std::vector<Value> Identifiers of all stored sets that are
+     * subsets of bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     * @throw std::system_error If a thread cannot be started
+     */
+    [[nodiscard]]
+    std::vector<Value> find_subsets(const binary_set &bs, unsigned int thread_count) const {
+        validate_capacity(bs);
+
+        const std::vector<std::size_t> targets = shards_under(bs);
+        std::size_t stored = 0;
+        for (std::size_t target : targets) stored += shards_[target].size.load(std::memory_order_relaxed);
+
+        if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+        const std::size_t workers = std::min({std::size_t{thread_count}, targets.size(), 1 + stored / values_per_query_thread});
+        if (workers <= 1) return gather(bs, targets, 0, 1);
+
+        std::vector<std::vector<Value>> partial(workers);
+        std::vector<std::exception_ptr> errors(workers);
+        auto work = [&](std::size_t t) {
+            try {
+                partial[t] = gather(bs, targets, t, workers);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        };
+
+        {
+            // jthreads join when the scope ends, also if starting one throws
+            std::vector<std::jthread> threads;
+            threads.reserve(workers - 1);
+            for (std::size_t t = 1; t < workers; ++t) threads.emplace_back(work, t);
+            work(0);
+        }
+
+        for (const std::exception_ptr &error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+        std::vector<Value> result = std::move(partial[0]);
+        for (std::size_t t = 1; t < workers; ++t) result.insert(result.end(), partial[t].begin(), partial[t].end());
+        return result;
+    }
+
+    /**
+     * @brief Removes every stored set from every shard.
+     */
+    void clear() {
+        for (shard &s : shards_) {
+            std::unique_lock lock(s.mutex);
+            s.searcher.clear();
+            s.size.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Returns the number of shards.
+     *
+     * @return std::size_t 2^prefix_bits
+     */
+    [[nodiscard]]
+    std::size_t shard_count() const noexcept {
+        return std::size_t{1} << prefix_bits_;
+    }
+
+    /**
+     * @brief Returns the number of leading elements keying the shards.
+     *
+     * @return unsigned int The prefix_bits given at construction
+     */
+    [[nodiscard]]
+    unsigned int prefix_bits() const noexcept {
+        return prefix_bits_;
+    }
+
+    /**
+     * @brief Returns the shard that holds the sets with the given prefix.
+     *
+     * The shard is not locked: use it only while no other thread writes to
+     * the sharded searcher.
+     *
+     * @param index Prefix of the shard: bit i is element i
+     * @return const basic_bs_searcher<Value>& The shard's searcher
+     *
+     * @throw std::out_of_range If index >= shard_count()
+     */
+    [[nodiscard]]
+    const basic_bs_searcher<Value> &shard_searcher(std::size_t index) const {
+        if (index >= shard_count()) throw std::out_of_range("Shard index out of range.");
+        return shards_[index].searcher;
+    }
+
+    /**
+     * @brief Estimates the heap and object memory held by all shards.
+     *
+     * @return std::size_t Size in bytes
+     */
+    [[nodiscard]]
+    std::size_t memory_usage() const {
+        std::size_t bytes = sizeof(*this);
+        for (const shard &s : shards_) {
+            std::shared_lock lock(s.mutex);
+            bytes += sizeof(shard) - sizeof(s.searcher) + s.searcher.memory_usage();
+        }
+        return bytes;
+    }
+
+   private:
+    struct shard {
+        mutable std::shared_mutex mutex;
+        basic_bs_searcher<Value> searcher;
+        std::atomic<std::size_t> size{0};  // Values stored, readable without the lock
+
+        explicit shard(unsigned int capacity) : searcher(capacity) {}
+    };
+
+    unsigned int capacity_;
+    unsigned int prefix_bits_;
+    std::deque<shard> shards_;  // Indexed by prefix; a deque since shards cannot move
+
+    void validate_capacity(const binary_set &bs) const {
+        if (capacity_ != bs.capacity()) {
+            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        }
+    }
+
+    // Bit i set iff bs holds element i, for the first prefix_bits_ elements
+    [[nodiscard]]
+    std::size_t prefix_of(const binary_set &bs) const noexcept {
+        return static_cast<std::size_t>(bs.word(0) & ((std::uint64_t{1} << prefix_bits_) - 1));
+    }
+
+    // Shards whose prefix is a submask of the query's prefix
+    [[nodiscard]]
+    std::vector<std::size_t> shards_under(const binary_set &bs) const {
+        const std::size_t prefix = prefix_of(bs);
+        std::vector<std::size_t> targets;
+        targets.reserve(std::size_t{1} << std::popcount(prefix));
+        for (std::size_t sub = prefix;; sub = (sub - 1) & prefix) {
+            targets.push_back(sub);
+            if (sub == 0) break;
+        }
+        return targets;
+    }
+
+    // Results of the targets first, first + stride, ... under shared locks
+    [[nodiscard]]
+    std::vector<Value> gather(const binary_set &bs, const std::vector<std::size_t> &targets, std::size_t first, std::size_t stride) const {
+        std::vector<Value> result;
+        for (std::size_t i = first; i < targets.size(); i += stride) {
+            const shard &s = shards_[targets[i]];
+            std::shared_lock lock(s.mutex);
+            const std::vector<Value> found = s.searcher.find_subsets(bs);
+            result.insert(result.end(), found.begin(), found.end());
+        }
+        return result;
+    }
+};
+
+using bs_sharded_searcher = basic_bs_sharded_searcher<>;
+
+/**
+ * @brief Family of binary_sets stored as a zero-suppressed decision diagram.
+ *
+ * A ZDD is a DAG in which node (i, lo, hi) represents the family lo of sets
+ * without element i plus the sets of family hi extended with element i. The
+ * terminals are the empty family (node 0) and the family holding only the
+ * empty set (node 1). Elements are tested in index order, nodes whose hi
+ * child is the empty family are never created, and every node is looked up in
+ * a unique table before being created, so equal sub-families are stored once.
+ *
+ * Unlike bs_searcher, whose tree stores every suffix of every path, a ZDD
+ * merges the identical subtrees of the family: families with a lot of shared
+ * structure take far fewer nodes. In exchange the family is a plain set of
+ * sets, without values or duplicates.
+ *
+ * Operations build new nodes and leave the replaced ones behind; once the
+ * dead nodes outnumber the live ones, the diagram is copied into a fresh
+ * store.
+ *
+ * Time complexity (Z = number of nodes):
+ * - add, remove, contains: O(capacity) lookups, plus the nodes rebuilt
+ * - union, intersection, difference: O(Z_this * Z_other) in the worst case
+ * - count: O(Z)
+ * - find_subsets: O(Z * capacity + matches * capacity) in the worst case
+ *
+ * Example:
+ * @code
+ * bs_zdd_family family(10);
+ * binary_set bs1(10);
+ * bs1.add(1); bs1.add(3);
+ * family.add(bs1);
+ *
+ * binary_set query(10);
+ * query.add(1); query.add(3); query.add(5);
+ * auto results = family.find_subsets(query);  // Returns {bs1}
+ * @endcode
+ */
+class bs_zdd_family {
+   public:
+    /**
+     * @brief Constructs an empty family of binary_sets with the specified
+     * capacity.
+     *
+     * @param capacity The capacity that all managed binary_sets must have
+     */
+    explicit bs_zdd_family(unsigned int capacity) : capacity_(capacity) {
+        reset();
+    }
+
+    /**
+     * @brief Adds a set to the family.
+     *
+     * @param bs The binary_set to add
+     * @return true if bs was added
+     * @return false if the family already held bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    bool add(const binary_set &bs) {
+        if (contains(bs)) return false;
+
+        operation_memo memo, imported;
+        const std::uint32_t set = single(bs);
+        root_ = unite(root_, set, *this, memo, imported);
+        collect_if_sparse();
+        return true;
+    }
+
+    /**
+     * @brief Removes a set from the family.
+     *
+     * @param bs The binary_set to remove
+     * @return true if bs was removed
+     * @return false if the family did not hold bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    bool remove(const binary_set &bs) {
+        if (!contains(bs)) return false;
+
+        operation_memo memo;
+        const std::uint32_t set = single(bs);
+        root_ = subtract(root_, set, *this, memo);
+        collect_if_sparse();
+        return true;
+    }
+
+    /**
+     * @brief Checks whether the family holds a set.
+     *
+     * @param bs The binary_set to look up
+     * @return true if bs is in the family
+     * @return false otherwise
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    bool contains(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        // Follow hi for the elements of bs and lo for the others; the
+        // elements a path skips must be absent from bs
+        std::uint32_t node = root_;
+        unsigned int next = 0;
+        while (node > 1) {
+            const zdd_node &n = nodes_[node];
+            for (; next < n.element; ++next) {
+                if (bs[next]) return false;
+            }
+            node = bs[n.element] ? n.hi : n.lo;
+            next = n.element + 1;
+        }
+        if (node == 0) return false;
+        for (; next < capacity_; ++next) {
+            if (bs[next]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of sets in the family.
+     *
+     * @return std::uint64_t Number of sets
+     */
+    [[nodiscard]]
+    std::uint64_t count() const {
+        std::vector<std::uint64_t> counts(nodes_.size(), 0);
+        std::vector<bool> done(nodes_.size(), false);
+        counts[1] = 1;
+        done[0] = done[1] = true;
+        return count_from(root_, counts, done);
+    }
+
+    /**
+     * @brief Checks whether the family is empty.
+     *
+     * @return true if the family holds no set
+     * @return false otherwise
+     */
+    [[nodiscard]]
+    bool empty() const noexcept {
+        return root_ == 0;
+    }
+
+    /**
+     * @brief Finds all sets of the family that are subsets of the query set.
+     *
+     * @param bs The query binary_set
+     * @return std::vector<binary_set> Every set of the family contained in bs
+     *
+     * @throw std::invalid_argument If bs has a different capacity than
+     * specified in constructor
+     */
+    [[nodiscard]]
+    std::vector<binary_set> find_subsets(const binary_set &bs) const {
+        validate_capacity(bs);
+
+        // Nodes known to hold no subset of bs, to skip them on later visits
+        std::vector<bool> barren(nodes_.size(), false);
+        std::vector<binary_set> result;
+        binary_set path = capacity_ > 0 ? binary_set(capacity_) : binary_set();
+        enumerate_subsets(root_, bs, path, barren, result);
+        return result;
+    }
+
+    /**
+     * @brief Adds every set of another family to this one.
+     *
+     * @param other Family to unite with
+     * @return bs_zdd_family& Reference to this family after the operation
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    bs_zdd_family &operator|=(const bs_zdd_family &other) {
+        validate_same_capacity(other);
+        if (&other == this) return *this;
+
+        operation_memo memo, imported;
+        root_ = unite(root_, other.root_, other, memo, imported);
+        collect_if_sparse();
+        return *this;
+    }
+
+    /**
+     * @brief Keeps only the sets that are also in another family.
+     *
+     * @param other Family to intersect with
+     * @return bs_zdd_family& Reference to this family after the operation
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    bs_zdd_family &operator&=(const bs_zdd_family &other) {
+        validate_same_capacity(other);
+        if (&other == this) return *this;
+
+        operation_memo memo;
+        root_ = intersect(root_, other.root_, other, memo);
+        collect_if_sparse();
+        return *this;
+    }
+
+    /**
+     * @brief Removes every set that is also in another family.
+     *
+     * @param other Family to subtract
+     * @return bs_zdd_family& Reference to this family after the operation
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    bs_zdd_family &operator-=(const bs_zdd_family &other) {
+        validate_same_capacity(other);
+        if (&other == this) {
+            clear();
+            return *this;
+        }
+
+        operation_memo memo;
+        root_ = subtract(root_, other.root_, other, memo);
+        collect_if_sparse();
+        return *this;
+    }
+
+    /**
+     * @brief Computes the union of two families.
+     *
+     * @param other Family to unite with
+     * @return bs_zdd_family The sets in either family
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    [[nodiscard]]
+    bs_zdd_family operator|(const bs_zdd_family &other) const {
+        bs_zdd_family result{*this};
+        result |= other;
+        return result;
+    }
+
+    /**
+     * @brief Computes the intersection of two families.
+     *
+     * @param other Family to intersect with
+     * @return bs_zdd_family The sets in both families
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    [[nodiscard]]
+    bs_zdd_family operator&(const bs_zdd_family &other) const {
+        bs_zdd_family result{*this};
+        result &= other;
+        return result;
+    }
+
+    /**
+     * @brief Computes the difference of two families.
+     *
+     * @param other Family to subtract
+     * @return bs_zdd_family The sets in this family but not in other
+     *
+     * @throw std::invalid_argument If the families have different capacities
+     */
+    [[nodiscard]]
+    bs_zdd_family operator-(const bs_zdd_family &other) const {
+        bs_zdd_family result{*this};
+        result -= other;
+        return result;
+    }
+
+    /**
+     * @brief Removes every set from the family.
+     */
+    void clear() {
+        reset();
+    }
+
+    /**
+     * @brief Returns the capacity of the sets in the family.
+     *
+     * @return unsigned int The capacity given at construction
+     */
+    [[nodiscard]]
+    unsigned int capacity() const noexcept {
+        return capacity_;
+    }
+
+    /**
+     * @brief Returns the number of nodes reachable from the root, terminals
+     * included.
+     *
+     * @return std::size_t Live node count
+     */
+    [[nodiscard]]
+    std::size_t node_count() const {
+        std::vector<bool> seen(nodes_.size(), false);
+        std::vector<std::uint32_t> stack{root_};
+        std::size_t live = 0;
+        seen[root_] = true;
+        while (!stack.empty()) {
+            const std::uint32_t node = stack.back();
+            stack.pop_back();
+            ++live;
+            if (node <= 1) continue;
+            for (std::uint32_t child : {nodes_[node].lo, nodes_[node].hi}) {
+                if (!seen[child]) {
+                    seen[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+        return live;
+    }
+
+    /**
+     * @brief Estimates the heap and object memory held by the family.
+     *
+     * Counts the node pool, dead nodes included, and the unique table, whose
+     * nodes are estimated as their entry plus one pointer.
+     *
+     * @return std::size_t Size in bytes
+     */
+    [[nodiscard]]
+    std::size_t memory_usage() const noexcept {
+        std::size_t bytes = sizeof(*this);
+        bytes += nodes_.capacity() * sizeof(zdd_node);
+        bytes += unique_.bucket_count() * sizeof(void *);
+        bytes += unique_.size() * (sizeof(std::pair<const zdd_node, std::uint32_t>) + sizeof(void *));
+        return bytes;
+    }
+
+   private:
+    struct zdd_node {
+        unsigned int element;  // Element tested; capacity_ for the terminals
+        std::uint32_t lo;      // Sets without element
+        std::uint32_t hi;      // Sets with element, which is dropped from them
+
+        bool operator==(const zdd_node &) const = default;
+    };
+
+    struct node_hash {
+        std::size_t operator()(const zdd_node &n) const noexcept {
+            std::uint64_t h = (std::uint64_t{n.element} << 40) ^ (std::uint64_t{n.lo} << 20) ^ n.hi;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    // Results of a binary operation keyed by its two operand nodes
+    using operation_memo = std::unordered_map<std::uint64_t, std::uint32_t>;
+
+    unsigned int capacity_;
+    std::vector<zdd_node> nodes_;                                      // 0 and 1 are the terminals
+    std::unordered_map<zdd_node, std::uint32_t, node_hash> unique_;    // Internal node -> its index
+    std::uint32_t root_{0};
+    std::size_t live_after_collection_{2};                             // Pool size after the last collection
+
+    void reset() {
+        nodes_.assign({zdd_node{capacity_, 0, 0}, zdd_node{capacity_, 1, 1}});
+        unique_.clear();
+        root_ = 0;
+        live_after_collection_ = 2;
+    }
+
+    void validate_capacity(const binary_set &bs) const {
+        if (capacity_ != bs.capacity()) {
+            throw std::invalid_argument("The binary_set has an unexpected capacity.");
+        }
+    }
+
+    void validate_same_capacity(const bs_zdd_family &other) const {
+        if (capacity_ != other.capacity_) {
+            throw std::invalid_argument("The two bs_zdd_family don't have the same capacity.");
+        }
+    }
+
+    [[nodiscard]]
+    static std::uint64_t memo_key(std::uint32_t a, std::uint32_t b) noexcept {
+        return (std::uint64_t{a} << 32) | b;
+    }
+
+    // The node (element, lo, hi), shared if it exists and suppressed if hi is empty
+    std::uint32_t make(unsigned int element, std::uint32_t lo, std::uint32_t hi) {
+        if (hi == 0) return lo;
+
+        const zdd_node key{element, lo, hi};
+        auto it = unique_.find(key);
+        if (it != unique_.end()) return it->second;
+
+        if (nodes_.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("bs_zdd_family has run out of node indices.");
+        }
+        const auto index = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back(key);
+        unique_.emplace(key, index);
+        return index;
+    }
+
+    // The family holding only bs, built from its last element up
+    std::uint32_t single(const binary_set &bs) {
+        std::uint32_t node = 1;
+        for (unsigned int i = capacity_; i-- > 0;) {
+            if (bs[i]) node = make(i, 0, node);
+        }
+        return node;
+    }
+
+    enum class operation { unite, intersect, subtract };
+
+    // Copy of node b of source's store into this store. Children are copied
+    // before their parents, with an explicit stack instead of recursion.
+    std::uint32_t import(std::uint32_t b, const bs_zdd_family &source, operation_memo &imported) {
+        if (&source == this) return b;
+
+        struct frame {
+            std::uint32_t node;
+            bool expanded;  // Whether the children's copies are on results
+        };
+
+        std::vector<frame> stack = {{b, false}};
+        std::vector<std::uint32_t> results;
+        while (!stack.empty()) {
+            const frame top = stack.back();
+            stack.pop_back();
+
+            if (!top.expanded) {
+                if (top.node <= 1) {
+                    results.push_back(top.node);
+                    continue;
+                }
+                auto it = imported.find(top.node);
+                if (it != imported.end()) {
+                    results.push_back(it->second);
+                    continue;
+                }
+                const zdd_node &n = source.nodes_[top.node];
+                stack.push_back({top.node, true});
+                stack.push_back({n.hi, false});
+                stack.push_back({n.lo, false});
+                continue;
+            }
+
+            const std::uint32_t hi = results.back();
+            results.pop_back();
+            const std::uint32_t lo = results.back();
+            const std::uint32_t result = make(source.nodes_[top.node].element, lo, hi);
+            results.back() = result;
+            imported.emplace(top.node, result);
+        }
+        return results.back();
+    }
+
+    // Result of op on node a of this store and node b of source's store, if
+    // a terminal rule decides it without looking at the children
+    std::optional<std::uint32_t> terminal(operation op, std::uint32_t a, std::uint32_t b, const bs_zdd_family &source,
+                                          operation_memo &imported) {
+        const bool same = &source == this && a == b;
+        switch (op) {
+            case operation::unite:
+                if (b == 0) return a;
+                if (a == 0) return import(b, source, imported);
+                if ((a == 1 && b == 1) || same) return a;
+                break;
+            case operation::intersect:
+                if (a == 0 || b == 0) return 0;
+                if ((a == 1 && b == 1) || same) return a;
+                break;
+            case operation::subtract:
+                if (a == 0) return 0;
+                if (b == 0) return a;
+                if ((a == 1 && b == 1) || same) return 0;
+                break;
+        }
+        return std::nullopt;
+    }
+
+    // Union, intersection or difference of node a of this store and node b of
+    // source's store. The operand pairs are expanded with an explicit stack:
+    // a node's lowest element leads, and when the elements differ only the
+    // side with the lower one descends.
+    std::uint32_t apply(operation op, std::uint32_t a, std::uint32_t b, const bs_zdd_family &source, operation_memo &memo,
+                        operation_memo &imported) {
+        struct frame {
+            std::uint32_t a;
+            std::uint32_t b;
+            bool expanded;  // Whether the children's results are on results
+        };
+
+        std::vector<frame> stack = {{a, b, false}};
+        std::vector<std::uint32_t> results;
+        while (!stack.empty()) {
+            const frame top = stack.back();
+            stack.pop_back();
+
+            // Copy the operands, since make() may reallocate the pool
+            const zdd_node x = nodes_[top.a];
+            const zdd_node y = source.nodes_[top.b];
+
+            if (!top.expanded) {
+                if (const auto result = terminal(op, top.a, top.b, source, imported)) {
+                    results.push_back(*result);
+                    continue;
+                }
+                auto it = memo.find(memo_key(top.a, top.b));
+                if (it != memo.end()) {
+                    results.push_back(it->second);
+                    continue;
+                }
+
+                stack.push_back({top.a, top.b, true});
+                if (x.element < y.element) {
+                    stack.push_back({x.lo, top.b, false});
+                } else if (x.element > y.element) {
+                    stack.push_back({top.a, y.lo, false});
+                } else {
+                    stack.push_back({x.hi, y.hi, false});
+                    stack.push_back({x.lo, y.lo, false});
+                }
+                continue;
+            }
+
+            std::uint32_t result;
+            if (x.element == y.element) {
+                const std::uint32_t hi = results.back();
+                results.pop_back();
+                result = make(x.element, results.back(), hi);
+            } else if (x.element < y.element) {
+                // Only this side holds x.element: its sets keep it, unless intersecting
+                result = op == operation::intersect ? results.back() : make(x.element, results.back(), x.hi);
+            } else {
+                // Only source holds y.element: its sets join a union and are ignored otherwise
+                result = op == operation::unite ? make(y.element, results.back(), import(y.hi, source, imported)) : results.back();
+            }
+            results.back() = result;
+            memo.emplace(memo_key(top.a, top.b), result);
+        }
+        return results.back();
+    }
+
+    std::uint32_t unite(std::uint32_t a, std::uint32_t b, const bs_zdd_family &source, operation_memo &memo, operation_memo &imported) {
+        return apply(operation::unite, a, b, source, memo, imported);
+    }
+
+    std::uint32_t intersect(std::uint32_t a, std::uint32_t b, const bs_zdd_family &source, operation_memo &memo) {
+        operation_memo imported;
+        return apply(operation::intersect, a, b, source, memo, imported);
+    }
+
+    std::uint32_t subtract(std::uint32_t a, std::uint32_t b, const bs_zdd_family &source, operation_memo &memo) {
+        operation_memo imported;
+        return apply(operation::subtract, a, b, source, memo, imported);
+    }
+
+    // Number of sets below node, counting each node once after its children
+    std::uint64_t count_from(std::uint32_t node, std::vector<std::uint64_t> &counts, std::vector<bool> &done) const {
+        std::vector<std::uint32_t> stack = {node};
+        while (!stack.empty()) {
+            const std::uint32_t top = stack.back();
+            if (done[top]) {
+                stack.pop_back();
+                continue;
+            }
+            const zdd_node &n = nodes_[top];
+            if (done[n.lo] && done[n.hi]) {
+                counts[top] = counts[n.lo] + counts[n.hi];
+                done[top] = true;
+                stack.pop_back();
+                continue;
+            }
+            if (!done[n.hi]) stack.push_back(n.hi);
+            if (!done[n.lo]) stack.push_back(n.lo);
+        }
+        return counts[node];
+    }
+
+    // Appends the sets of node that fit in query, each extended with path,
+    // lo branches first. Nodes found to hold none are marked barren.
+    void enumerate_subsets(std::uint32_t node, const binary_set &query, binary_set &path, std::vector<bool> &barren,
+                           std::vector<binary_set> &result) const {
+        // Settles a terminal or barren node at once, setting found; returns
+        // whether node is internal and has to be enumerated instead
+        auto settle = [&](std::uint32_t child, bool &found) {
+            if (child == 0 || barren[child]) {
+                found = false;
+            } else if (child == 1) {
+                result.push_back(path);
+                found = true;
+            } else {
+                return true;
+            }
+            return false;
+        };
+
+        // Stage 0: lo branch next; 1: lo branch done; 2: hi branch done
+        struct frame {
+            std::uint32_t node;
+            unsigned int stage;
+            bool found;  // Whether a branch enumerated so far held a set
+        };
+
+        bool found = false;
+        if (!settle(node, found)) return;
+
+        std::vector<frame> stack = {{node, 0, false}};
+        while (!stack.empty()) {
+            frame &top = stack.back();
+            const zdd_node &n = nodes_[top.node];
+
+            if (top.stage == 0 || (top.stage == 1 && query[n.element])) {
+                const std::uint32_t child = top.stage == 0 ? n.lo : n.hi;
+                if (top.stage++ == 1) path.add(n.element);
+                if (settle(child, found)) {
+                    stack.push_back({child, 0, false});
+                } else {
+                    top.found = top.found || found;
+                }
+                continue;
+            }
+
+            if (top.stage == 2) path.remove(n.element);
+            found = top.found;
+            if (!found) barren[top.node] = true;
+            stack.pop_back();
+            if (!stack.empty()) stack.back().found = stack.back().found || found;
+        }
+    }
+
+    // Copies the live diagram into a fresh store once dead nodes dominate
+    void collect_if_sparse() {
+        if (nodes_.size() < 1024 || nodes_.size() < 2 * live_after_collection_) return;
+
+        bs_zdd_family fresh(capacity_);
+        operation_memo imported;
+        fresh.root_ = fresh.import(root_, *this, imported);
+        fresh.live_after_collection_ = fresh.nodes_.size();
+        *this = std::move(fresh);
     }
 };
 
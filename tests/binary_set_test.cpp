@@ -452,3 +452,40 @@ TEST(BinarySetTest, CopyAssignment) {
     EXPECT_TRUE(b.contains(1));
     EXPECT_TRUE(b.contains(5));
 }
+
+TEST(BinarySetTest, Hash) {
+    binary_set a(100);
+    a.add(3);
+    a.add(99);
+    binary_set b(100);
+    b.add(99);
+    b.add(3);
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_EQ(std::hash<binary_set>{}(a), a.hash());
+
+    // The complement masks its padding bits, so it hashes like a filled set
+    EXPECT_EQ((!binary_set(13)).hash(), binary_set(13, true).hash());
+
+    b.remove(99);
+    EXPECT_NE(a.hash(), b.hash());
+    EXPECT_NE(binary_set(8).hash(), binary_set(9).hash());
+}
+
+TEST(BinarySetTest, Words) {
+    binary_set bs(130);
+    bs.add(0);
+    bs.add(63);
+    bs.add(64);
+    bs.add(129);
+    EXPECT_EQ(bs.word_count(), 3u);
+    EXPECT_EQ(bs.word(0), (std::uint64_t{1} << 63) | 1u);
+    EXPECT_EQ(bs.word(1), 1u);
+    EXPECT_EQ(bs.word(2), 2u);
+    EXPECT_EQ(bs.word(3), 0u);
+
+    // Padding bits stay clear
+    EXPECT_EQ(binary_set(130, true).word(2), 3u);
+    EXPECT_EQ((!binary_set(70)).word(1), 0x3Fu);
+    EXPECT_EQ(binary_set().word_count(), 0u);
+    EXPECT_EQ(binary_set().word(0), 0u);
+}
@@ -0,0 +1,132 @@
+#include <random>
+
+#include "../binary_set.hxx"
+#include "gtest/gtest.h"
+
+TEST(BSBitmapSearcherTest, Constructor) {
+    bs_bitmap_searcher searcher(10);
+    binary_set bs(10);
+    // Should not throw
+    EXPECT_TRUE(searcher.find_subsets(bs).empty());
+}
+
+TEST(BSBitmapSearcherTest, AddAndFind) {
+    bs_bitmap_searcher searcher(8);
+
+    binary_set bs1(8);
+    bs1.add(1);
+    bs1.add(3);
+    searcher.add(101, bs1);
+
+    binary_set bs2(8);
+    bs2.add(1);
+    searcher.add(102, bs2);
+
+    binary_set bs3(8);
+    bs3.add(1);
+    bs3.add(3);
+    bs3.add(5);
+    searcher.add(103, bs3);
+
+    binary_set query(8);
+    query.add(1);
+    query.add(3);
+    query.add(4);
+    query.add(6);
+
+    std::vector<unsigned int> results = searcher.find_subsets(query);
+    std::sort(results.begin(), results.end());
+
+    std::vector<unsigned int> expected = {101, 102};
+    EXPECT_EQ(results, expected);
+}
+
+TEST(BSBitmapSearcherTest, InvalidCapacity) {
+    bs_bitmap_searcher searcher(8);
+    binary_set bs(10);
+    EXPECT_THROW(searcher.add(101, bs), std::invalid_argument);
+    EXPECT_THROW(searcher.remove(101, bs), std::invalid_argument);
+    EXPECT_THROW(searcher.find_subsets(bs), std::invalid_argument);
+}
+
+TEST(BSBitmapSearcherTest, RemoveAndReuseSlot) {
+    bs_bitmap_searcher searcher(4);
+
+    binary_set bs1(4);
+    bs1.add(1);
+    searcher.add(1, bs1);
+
+    binary_set bs2(4);
+    bs2.add(1);
+    bs2.add(2);
+    searcher.add(2, bs2);
+
+    EXPECT_FALSE(searcher.remove(1, bs2));
+    EXPECT_FALSE(searcher.remove(3, bs1));
+    EXPECT_TRUE(searcher.remove(1, bs1));
+    EXPECT_FALSE(searcher.remove(1, bs1));
+
+    binary_set query(4, true);
+    std::vector<unsigned int> expected = {2};
+    EXPECT_EQ(searcher.find_subsets(query), expected);
+
+    // The freed slot must not leak the elements of the removed set
+    binary_set empty(4);
+    searcher.add(3, empty);
+    expected = {3};
+    EXPECT_EQ(searcher.find_subsets(empty), expected);
+}
+
+TEST(BSBitmapSearcherTest, Duplicates) {
+    bs_bitmap_searcher searcher(4);
+    binary_set bs(4);
+    bs.add(1);
+
+    searcher.add(1, bs);
+    searcher.add(1, bs);
+    EXPECT_EQ(searcher.find_subsets(bs).size(), 2);
+
+    EXPECT_TRUE(searcher.remove(1, bs));
+    EXPECT_EQ(searcher.find_subsets(bs).size(), 1);
+
+    EXPECT_TRUE(searcher.remove(1, bs));
+    EXPECT_TRUE(searcher.find_subsets(bs).empty());
+}
+
+TEST(BSBitmapSearcherTest, MatchesTreeSearcher) {
+    const unsigned int capacity = 20;
+    std::mt19937 gen(42);
+    std::bernoulli_distribution stored_bit(0.2);
+    std::bernoulli_distribution query_bit(0.6);
+
+    bs_searcher tree(capacity);
+    bs_bitmap_searcher bitmap(capacity);
+    std::vector<binary_set> stored;
+
+    // Enough sets to span several posting words
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        tree.add(id, bs);
+        bitmap.add(id, bs);
+        stored.push_back(bs);
+    }
+    for (unsigned int id = 0; id < 300; id += 3) {
+        EXPECT_TRUE(tree.remove(id, stored[id]));
+        EXPECT_TRUE(bitmap.remove(id, stored[id]));
+    }
+
+    for (int q = 0; q < 50; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+        auto expected = tree.find_subsets(query);
+        auto results = bitmap.find_subsets(query);
+        std::sort(expected.begin(), expected.end());
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+    }
+}
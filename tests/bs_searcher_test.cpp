@@ -1,3 +1,7 @@
+#include <cstdint>
+#include <random>
+#include <span>
+
 #include "../binary_set.hxx"
 #include "gtest/gtest.h"
 
@@ -356,3 +360,1218 @@ TEST(BSSearcherTest, RemoveNonExistent) {
     EXPECT_FALSE(searcher.remove(2, bs));
     EXPECT_FALSE(searcher.remove(1, bs2));
 }
+
+TEST(BSSearcherTest, DefaultElementOrder) {
+    bs_searcher searcher(4);
+    std::vector<unsigned int> expected = {0, 1, 2, 3};
+    EXPECT_EQ(searcher.element_order(), expected);
+}
+
+TEST(BSSearcherTest, RebuildReordersByStatistics) {
+    // Large enough that element 71 is beyond the reach of the root summary
+    bs_searcher searcher(72);
+
+    // Element 71 is frequent in stored sets and always absent from queries
+    binary_set bs1(72);
+    bs1.add(71);
+    searcher.add(1, bs1);
+
+    binary_set bs2(72);
+    bs2.add(0);
+    bs2.add(71);
+    searcher.add(2, bs2);
+
+    binary_set bs3(72);
+    bs3.add(1);
+    searcher.add(3, bs3);
+
+    binary_set query(72);
+    query.add(0);
+    query.add(1);
+    query.add(2);
+    searcher.observe_query(query);
+
+    const std::size_t visited_before = searcher.visited_nodes(query);
+    searcher.rebuild();
+    EXPECT_EQ(searcher.element_order()[0], 71);
+    EXPECT_LT(searcher.visited_nodes(query), visited_before);
+
+    // Results are unaffected by the order
+    std::vector<unsigned int> expected = {3};
+    EXPECT_EQ(searcher.find_subsets(query), expected);
+
+    binary_set full(72, true);
+    std::vector<unsigned int> results = searcher.find_subsets(full);
+    std::sort(results.begin(), results.end());
+    expected = {1, 2, 3};
+    EXPECT_EQ(results, expected);
+
+    // add and remove keep working with the new order
+    EXPECT_TRUE(searcher.remove(2, bs2));
+    searcher.add(4, bs2);
+    results = searcher.find_subsets(full);
+    std::sort(results.begin(), results.end());
+    expected = {1, 3, 4};
+    EXPECT_EQ(results, expected);
+}
+
+TEST(BSSearcherTest, RebuildKeepsDuplicates) {
+    bs_searcher searcher(3);
+    binary_set bs(3);
+    bs.add(2);
+    searcher.add(7, bs);
+    searcher.add(7, bs);
+
+    searcher.rebuild();
+    EXPECT_EQ(searcher.find_subsets(bs).size(), 2);
+}
+
+TEST(BSSearcherTest, ObserveQueryWithInvalidCapacity) {
+    bs_searcher searcher(8);
+    binary_set bs(10);
+    EXPECT_THROW(searcher.observe_query(bs), std::invalid_argument);
+    EXPECT_THROW((void)searcher.visited_nodes(bs), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, SummaryPruning) {
+    bs_searcher searcher(8);
+
+    binary_set bs1(8);
+    bs1.add(0);
+    bs1.add(1);
+    bs1.add(7);
+    searcher.add(1, bs1);
+
+    binary_set bs2(8);
+    bs2.add(3);
+    bs2.add(4);
+    bs2.add(7);
+    searcher.add(2, bs2);
+
+    // Every stored set requires element 7: the root already rules the query out
+    binary_set query(8, true);
+    query.remove(7);
+    EXPECT_EQ(searcher.visited_nodes(query), 0);
+    EXPECT_TRUE(searcher.find_subsets(query).empty());
+
+    // The query has fewer elements than the smallest stored set
+    binary_set small(8);
+    small.add(0);
+    small.add(7);
+    EXPECT_EQ(searcher.visited_nodes(small), 0);
+
+    // Summaries recover once the only set lacking a required element goes away
+    binary_set bs3(8);
+    bs3.add(0);
+    searcher.add(3, bs3);
+    std::vector<unsigned int> expected = {3};
+    EXPECT_EQ(searcher.find_subsets(query), expected);
+    EXPECT_TRUE(searcher.remove(3, bs3));
+    EXPECT_EQ(searcher.visited_nodes(query), 0);
+}
+
+TEST(BSSearcherTest, MatchesLinearScan) {
+    const unsigned int capacity = 70;  // Spans more than one summary window
+    std::mt19937 gen(7);
+    std::bernoulli_distribution stored_bit(0.1);
+    std::bernoulli_distribution query_bit(0.8);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 400; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+    for (unsigned int id = 0; id < 400; id += 2) {
+        EXPECT_TRUE(searcher.remove(id, stored[id]));
+    }
+
+    for (int q = 0; q < 100; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+
+        std::vector<unsigned int> expected;
+        for (unsigned int id = 1; id < 400; id += 2) {
+            if (query.contains(stored[id])) expected.push_back(id);
+        }
+        std::vector<unsigned int> results = searcher.find_subsets(query);
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+    }
+}
+
+TEST(BSSearcherTest, FindMinimalAndMaximalSubsets) {
+    bs_searcher searcher(6);
+
+    binary_set a(6);  // {1}
+    a.add(1);
+    searcher.add(1, a);
+
+    binary_set b(6);  // {1, 2}
+    b.add(1);
+    b.add(2);
+    searcher.add(2, b);
+
+    binary_set c(6);  // {3}
+    c.add(3);
+    searcher.add(3, c);
+
+    binary_set d(6);  // {1, 2, 4}, not a subset of the query
+    d.add(1);
+    d.add(2);
+    d.add(4);
+    searcher.add(4, d);
+
+    searcher.add(5, a);  // Duplicate of {1}
+
+    binary_set query(6);
+    query.add(1);
+    query.add(2);
+    query.add(3);
+
+    std::vector<unsigned int> minimal = searcher.find_minimal_subsets(query);
+    std::sort(minimal.begin(), minimal.end());
+    std::vector<unsigned int> expected = {1, 3, 5};
+    EXPECT_EQ(minimal, expected);
+
+    std::vector<unsigned int> maximal = searcher.find_maximal_subsets(query);
+    std::sort(maximal.begin(), maximal.end());
+    expected = {2, 3};
+    EXPECT_EQ(maximal, expected);
+
+    binary_set bad(7);
+    EXPECT_THROW((void)searcher.find_minimal_subsets(bad), std::invalid_argument);
+    EXPECT_THROW((void)searcher.find_maximal_subsets(bad), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, KeepMinimalInsertMode) {
+    bs_searcher searcher(5, bs_searcher::insert_mode::keep_minimal);
+    EXPECT_EQ(searcher.mode(), bs_searcher::insert_mode::keep_minimal);
+
+    binary_set ab(5);
+    ab.add(0);
+    ab.add(1);
+    binary_set abc(5);
+    abc.add(0);
+    abc.add(1);
+    abc.add(2);
+    binary_set bd(5);
+    bd.add(1);
+    bd.add(3);
+    binary_set b(5);
+    b.add(1);
+
+    EXPECT_TRUE(searcher.add(1, ab));
+    EXPECT_FALSE(searcher.add(2, abc));  // Dominated by {0, 1}
+    EXPECT_FALSE(searcher.add(3, ab));   // Equal sets dominate each other
+    EXPECT_TRUE(searcher.add(4, bd));
+
+    // {1} evicts both {0, 1} and {1, 3}
+    EXPECT_TRUE(searcher.add(5, b));
+    binary_set full(5, true);
+    std::vector<unsigned int> expected = {5};
+    EXPECT_EQ(searcher.find_subsets(full), expected);
+}
+
+TEST(BSSearcherTest, KeepMaximalInsertMode) {
+    bs_searcher searcher(5, bs_searcher::insert_mode::keep_maximal);
+
+    binary_set a(5);
+    a.add(0);
+    binary_set ab(5);
+    ab.add(0);
+    ab.add(1);
+    binary_set c(5);
+    c.add(2);
+    binary_set abc(5);
+    abc.add(0);
+    abc.add(1);
+    abc.add(2);
+
+    EXPECT_TRUE(searcher.add(1, ab));
+    EXPECT_FALSE(searcher.add(2, a));  // Dominated by {0, 1}
+    EXPECT_TRUE(searcher.add(3, c));
+
+    binary_set full(5, true);
+    std::vector<unsigned int> results = searcher.find_subsets(full);
+    std::sort(results.begin(), results.end());
+    std::vector<unsigned int> expected = {1, 3};
+    EXPECT_EQ(results, expected);
+
+    // {0, 1, 2} evicts both stored sets
+    EXPECT_TRUE(searcher.add(4, abc));
+    expected = {4};
+    EXPECT_EQ(searcher.find_subsets(full), expected);
+}
+
+TEST(BSSearcherTest, BulkLoadMatchesAdd) {
+    const unsigned int capacity = 70;  // Keys span two words
+    std::mt19937 gen(11);
+    std::bernoulli_distribution stored_bit(0.1);
+    std::bernoulli_distribution query_bit(0.8);
+
+    std::vector<std::pair<unsigned int, binary_set>> entries;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        entries.emplace_back(id, bs);
+    }
+    entries.emplace_back(300, entries[5].second);  // Duplicate set
+
+    bs_searcher added(capacity);
+    for (const auto &[id, bs] : entries) added.add(id, bs);
+    bs_searcher loaded(capacity);
+    loaded.add(999, binary_set(capacity));  // Replaced by the bulk load
+    loaded.bulk_load(entries);
+
+    for (int q = 0; q < 50; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+        std::vector<unsigned int> expected = added.find_subsets(query);
+        std::vector<unsigned int> results = loaded.find_subsets(query);
+        std::sort(expected.begin(), expected.end());
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+        EXPECT_EQ(loaded.visited_nodes(query), added.visited_nodes(query));
+    }
+
+    // The loaded tree stays updatable
+    EXPECT_TRUE(loaded.remove(5, entries[5].second));
+    EXPECT_TRUE(loaded.remove(300, entries[5].second));
+    EXPECT_FALSE(loaded.remove(999, binary_set(capacity)));
+    EXPECT_TRUE(loaded.add(301, entries[5].second));
+    std::vector<unsigned int> results = loaded.find_subsets(entries[5].second);
+    EXPECT_NE(std::find(results.begin(), results.end(), 301u), results.end());
+}
+
+TEST(BSSearcherTest, BulkLoadEmptyAndInvalid) {
+    bs_searcher searcher(5);
+    binary_set bs(5);
+    bs.add(1);
+    searcher.add(1, bs);
+
+    std::vector<std::pair<unsigned int, binary_set>> invalid = {{2, bs}, {3, binary_set(6)}};
+    EXPECT_THROW(searcher.bulk_load(invalid), std::invalid_argument);
+    std::vector<unsigned int> expected = {1};
+    EXPECT_EQ(searcher.find_subsets(bs), expected);
+
+    searcher.bulk_load(std::vector<std::pair<unsigned int, binary_set>>{});
+    EXPECT_TRUE(searcher.find_subsets(binary_set(5, true)).empty());
+}
+
+TEST(BSSearcherTest, BulkLoadKeepMinimal) {
+    bs_searcher searcher(5, bs_searcher::insert_mode::keep_minimal);
+
+    binary_set a(5);
+    a.add(0);
+    binary_set ab(5);
+    ab.add(0);
+    ab.add(1);
+    std::vector<std::pair<unsigned int, binary_set>> entries = {{1, ab}, {2, a}};
+    searcher.bulk_load(entries);
+
+    std::vector<unsigned int> expected = {2};
+    EXPECT_EQ(searcher.find_subsets(binary_set(5, true)), expected);
+}
+
+TEST(BSSearcherTest, AddParallelMatchesAdd) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(13);
+    std::bernoulli_distribution stored_bit(0.3);
+    std::bernoulli_distribution query_bit(0.8);
+
+    auto random_entries = [&](unsigned int first, unsigned int count) {
+        std::vector<std::pair<unsigned int, binary_set>> entries;
+        for (unsigned int id = first; id < first + count; ++id) {
+            binary_set bs(capacity);
+            for (unsigned int i = 0; i < capacity; ++i) {
+                if (stored_bit(gen)) bs.add(i);
+            }
+            entries.emplace_back(id, bs);
+        }
+        return entries;
+    };
+    const auto existing = random_entries(0, 100);
+    auto batch = random_entries(100, 2000);
+    batch.emplace_back(5000, existing[3].second);  // Lands on an existing leaf
+    batch.emplace_back(5001, batch[7].second);     // Duplicate within the batch
+
+    for (unsigned int threads : {1u, 3u, 0u}) {
+        bs_searcher added(capacity, bs_searcher::insert_mode::plain, true);
+        bs_searcher parallel(capacity, bs_searcher::insert_mode::plain, true);
+        for (const auto &[id, bs] : existing) {
+            added.add(id, bs);
+            parallel.add(id, bs);
+        }
+        for (const auto &[id, bs] : batch) added.add(id, bs);
+        parallel.add_parallel(batch, threads);
+
+        EXPECT_EQ(parallel.stats().node_count, added.stats().node_count);
+        EXPECT_EQ(parallel.stats().value_count, added.stats().value_count);
+        for (int q = 0; q < 20; ++q) {
+            binary_set query(capacity);
+            for (unsigned int i = 0; i < capacity; ++i) {
+                if (query_bit(gen)) query.add(i);
+            }
+            std::vector<unsigned int> expected = added.find_subsets(query);
+            std::vector<unsigned int> results = parallel.find_subsets(query);
+            std::sort(expected.begin(), expected.end());
+            std::sort(results.begin(), results.end());
+            EXPECT_EQ(results, expected);
+            EXPECT_EQ(parallel.visited_nodes(query), added.visited_nodes(query));
+        }
+
+        // Spliced leaves are indexed and stay updatable
+        EXPECT_TRUE(parallel.remove(5000u));
+        EXPECT_TRUE(parallel.remove(150u));
+        EXPECT_TRUE(parallel.remove(5001, batch[7].second));
+        EXPECT_TRUE(parallel.remove(3, existing[3].second));
+    }
+}
+
+TEST(BSSearcherTest, AddParallelSmallCapacityAndModes) {
+    // Fewer levels than a partition prefix: the partitions are the leaves
+    bs_searcher searcher(3);
+    std::vector<std::pair<unsigned int, binary_set>> entries;
+    for (unsigned int id = 0; id < 16; ++id) {
+        binary_set bs(3);
+        for (unsigned int i = 0; i < 3; ++i) {
+            if ((id >> i) & 1u) bs.add(i);
+        }
+        entries.emplace_back(id, bs);
+    }
+    searcher.add_parallel(entries, 2);
+    EXPECT_EQ(searcher.find_subsets(binary_set(3, true)).size(), 16u);
+    EXPECT_EQ(searcher.find_subsets(binary_set(3)).size(), 2u);
+    EXPECT_NO_THROW(searcher.add_parallel(std::vector<std::pair<unsigned int, binary_set>>{}));
+
+    // Insert modes keep refusing dominated sets
+    bs_searcher minimal(3, bs_searcher::insert_mode::keep_minimal);
+    minimal.add_parallel(entries, 2);
+    EXPECT_EQ(minimal.find_subsets(binary_set(3, true)), std::vector<unsigned int>{0});
+
+    entries.emplace_back(99, binary_set(4));
+    EXPECT_THROW(searcher.add_parallel(entries), std::invalid_argument);
+    EXPECT_EQ(searcher.find_subsets(binary_set(3, true)).size(), 16u);
+}
+
+TEST(BSSearcherTest, MergeMatchesAdd) {
+    const unsigned int capacity = 40;
+    std::mt19937 gen(29);
+    std::bernoulli_distribution stored_bit(0.2);
+    std::bernoulli_distribution query_bit(0.8);
+
+    std::vector<binary_set> sets;
+    for (int i = 0; i < 400; ++i) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (stored_bit(gen)) bs.add(e);
+        }
+        sets.push_back(bs);
+    }
+
+    bs_searcher all(capacity, bs_searcher::insert_mode::plain, true);
+    bs_searcher left(capacity, bs_searcher::insert_mode::plain, true);
+    bs_searcher right(capacity, bs_searcher::insert_mode::plain, true);
+    for (unsigned int id = 0; id < sets.size(); ++id) {
+        all.add(id, sets[id]);
+        // Sets 100..199 go to both sides, under different values
+        if (id < 200) left.add(id, sets[id]);
+        if (id >= 100) right.add(id >= 200 ? id : id + 1000, sets[id]);
+        if (id >= 100 && id < 200) all.add(id + 1000, sets[id]);
+    }
+
+    left.merge(std::move(right));
+    EXPECT_EQ(left.stats().node_count, all.stats().node_count);
+    EXPECT_EQ(left.stats().value_count, all.stats().value_count);
+    EXPECT_EQ(right.stats().value_count, 0u);
+    for (int q = 0; q < 30; ++q) {
+        binary_set query(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (query_bit(gen)) query.add(e);
+        }
+        std::vector<unsigned int> expected = all.find_subsets(query);
+        std::vector<unsigned int> results = left.find_subsets(query);
+        std::sort(expected.begin(), expected.end());
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+        EXPECT_EQ(left.visited_nodes(query), all.visited_nodes(query));
+    }
+
+    // Merged values are indexed
+    EXPECT_TRUE(left.remove(1150u));
+    EXPECT_TRUE(left.remove(350u));
+    EXPECT_TRUE(left.remove(50u));
+
+    EXPECT_THROW(left.merge(bs_searcher(capacity + 1)), std::invalid_argument);
+    EXPECT_THROW(left.merge(std::move(left)), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, MergeFallsBackToAdd) {
+    binary_set a(4), b(4);
+    a.add(1);
+    b.add(1);
+    b.add(2);
+
+    // Different element orders
+    bs_searcher reordered(4);
+    reordered.add(2, b);
+    reordered.observe_query(a);
+    reordered.rebuild();
+    ASSERT_NE(reordered.element_order(), bs_searcher(4).element_order());
+    bs_searcher plain(4);
+    plain.add(1, a);
+    plain.merge(std::move(reordered));
+    EXPECT_EQ(plain.find_subsets(b).size(), 2u);
+
+    // Insert modes still refuse dominated sets
+    bs_searcher minimal(4, bs_searcher::insert_mode::keep_minimal);
+    minimal.add(1, a);
+    bs_searcher other(4);
+    other.add(2, b);
+    minimal.merge(std::move(other));
+    EXPECT_EQ(minimal.find_subsets(b), std::vector<unsigned int>{1});
+}
+
+TEST(BSSearcherTest, ExtractIf) {
+    const unsigned int capacity = 12;
+    bs_searcher searcher(capacity, bs_searcher::insert_mode::plain, true);
+    std::vector<binary_set> sets;
+    for (unsigned int id = 0; id < 64; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < 6; ++e) {
+            if ((id >> e) & 1u) bs.add(e);
+        }
+        sets.push_back(bs);
+        searcher.add(id, bs);
+        searcher.add(id + 100, bs);  // Every leaf holds two values
+    }
+
+    // Odd values, and every set holding element 5
+    bs_searcher extracted =
+        searcher.extract_if([](unsigned int value, const binary_set &bs) { return value % 2 == 1 || bs.contains(5); });
+
+    std::vector<unsigned int> kept = searcher.find_subsets(binary_set(capacity, true));
+    std::vector<unsigned int> moved = extracted.find_subsets(binary_set(capacity, true));
+    std::sort(kept.begin(), kept.end());
+    std::sort(moved.begin(), moved.end());
+    std::vector<unsigned int> expected_kept, expected_moved;
+    for (unsigned int id = 0; id < 64; ++id) {
+        for (unsigned int value : {id, id + 100}) {
+            (value % 2 == 1 || id >= 32 ? expected_moved : expected_kept).push_back(value);
+        }
+    }
+    std::sort(expected_kept.begin(), expected_kept.end());
+    std::sort(expected_moved.begin(), expected_moved.end());
+    EXPECT_EQ(kept, expected_kept);
+    EXPECT_EQ(moved, expected_moved);
+
+    // Both sides keep their index and sets
+    EXPECT_TRUE(extracted.remove(33u));
+    EXPECT_TRUE(searcher.remove(2u));
+    EXPECT_FALSE(searcher.remove(3u));
+    std::vector<unsigned int> exact = extracted.find_exact(sets[40]);
+    std::sort(exact.begin(), exact.end());
+    EXPECT_EQ(exact, (std::vector<unsigned int>{40, 140}));
+    EXPECT_TRUE(searcher.extract_if([](unsigned int, const binary_set &) { return false; }).find_subsets(binary_set(capacity, true)).empty());
+}
+
+TEST(BSSearcherTest, Clear) {
+    bs_searcher searcher(5);
+    binary_set bs(5);
+    bs.add(3);
+    searcher.add(1, bs);
+    searcher.clear();
+    EXPECT_TRUE(searcher.find_subsets(bs).empty());
+    EXPECT_EQ(searcher.visited_nodes(bs), 0u);
+
+    searcher.add(2, bs);
+    std::vector<unsigned int> expected = {2};
+    EXPECT_EQ(searcher.find_subsets(bs), expected);
+}
+
+TEST(BSSearcherTest, Stats) {
+    bs_searcher searcher(3);
+    bs_searcher::statistics empty = searcher.stats();
+    EXPECT_EQ(empty.node_count, 1u);
+    EXPECT_EQ(empty.leaf_count, 0u);
+    EXPECT_EQ(empty.value_count, 0u);
+    EXPECT_EQ(empty.fan_out, std::vector<double>(3, 0.0));
+    EXPECT_EQ(empty.bytes_per_set, 0.0);
+
+    binary_set a(3);
+    a.add(0);
+    binary_set b(3);
+    b.add(0);
+    b.add(2);
+    searcher.add(1, a);
+    searcher.add(2, b);
+    searcher.add(3, b);
+
+    // Paths {0}: right, left, left and {0, 2}: right, left, right
+    bs_searcher::statistics stats = searcher.stats();
+    EXPECT_EQ(stats.node_count, 5u);
+    EXPECT_EQ(stats.leaf_count, 2u);
+    EXPECT_EQ(stats.value_count, 3u);
+    std::vector<double> expected_fan_out = {1.0, 1.0, 2.0};
+    EXPECT_EQ(stats.fan_out, expected_fan_out);
+    EXPECT_GT(searcher.memory_usage(), sizeof(bs_searcher));
+    EXPECT_DOUBLE_EQ(stats.bytes_per_set, static_cast<double>(searcher.memory_usage()) / 3.0);
+
+    // The element order and both per-element counters are counted in full
+    const bs_searcher wide(1000);
+    EXPECT_GE(wide.memory_usage(), sizeof(bs_searcher) + 1000 * (sizeof(unsigned int) + sizeof(std::size_t)));
+
+    // Pruned nodes are no longer reachable
+    searcher.remove(1, a);
+    stats = searcher.stats();
+    EXPECT_EQ(stats.node_count, 4u);
+    EXPECT_EQ(stats.leaf_count, 1u);
+    EXPECT_EQ(stats.value_count, 2u);
+}
+
+TEST(BSSearcherTest, RemoveByValue) {
+    bs_searcher searcher(5, bs_searcher::insert_mode::plain, true);
+
+    binary_set a(5);
+    a.add(1);
+    binary_set b(5);
+    b.add(1);
+    b.add(3);
+    for (unsigned int id = 0; id < 6; ++id) searcher.add(id, a);  // One crowded leaf
+    searcher.add(10, b);
+
+    EXPECT_TRUE(searcher.remove(2));
+    EXPECT_TRUE(searcher.remove(0));  // Swaps the leaf's last value into place
+    EXPECT_TRUE(searcher.remove(10));
+    EXPECT_FALSE(searcher.remove(10));
+    EXPECT_TRUE(searcher.remove(5, a));  // Set-based removal keeps the index in sync
+    EXPECT_FALSE(searcher.remove(5));
+
+    binary_set full(5, true);
+    std::vector<unsigned int> results = searcher.find_subsets(full);
+    std::sort(results.begin(), results.end());
+    std::vector<unsigned int> expected = {1, 3, 4};
+    EXPECT_EQ(results, expected);
+
+    // The emptied branch of b was pruned, along with its summaries
+    EXPECT_EQ(searcher.stats().node_count, 6u);
+    for (unsigned int id : expected) EXPECT_TRUE(searcher.remove(id));
+    EXPECT_TRUE(searcher.find_subsets(full).empty());
+    EXPECT_EQ(searcher.stats().node_count, 1u);
+}
+
+TEST(BSSearcherTest, RemoveByValueAfterBulkLoad) {
+    bs_searcher searcher(4, bs_searcher::insert_mode::plain, true);
+    binary_set a(4);
+    a.add(0);
+    binary_set b(4);
+    b.add(2);
+    std::vector<std::pair<unsigned int, binary_set>> entries = {{1, a}, {2, b}, {3, a}};
+    searcher.bulk_load(entries);
+
+    EXPECT_TRUE(searcher.remove(1));
+    EXPECT_TRUE(searcher.remove(2));
+    std::vector<unsigned int> expected = {3};
+    EXPECT_EQ(searcher.find_subsets(binary_set(4, true)), expected);
+}
+
+TEST(BSSearcherTest, RemoveByValueWithoutIndex) {
+    bs_searcher searcher(5);
+    EXPECT_THROW(searcher.remove(1), std::logic_error);
+}
+
+TEST(BSSearcherTest, SixtyFourBitPayload) {
+    basic_bs_searcher<std::uint64_t> searcher(6, basic_bs_searcher<std::uint64_t>::insert_mode::plain, true);
+    const std::uint64_t big = std::uint64_t{1} << 40;
+
+    binary_set a(6);
+    a.add(2);
+    binary_set b(6);
+    b.add(2);
+    b.add(4);
+    searcher.add(big, a);
+    searcher.add(big + 1, a);
+    searcher.add(big + 2, b);
+
+    binary_set query(6);
+    query.add(2);
+    std::vector<std::uint64_t> results = searcher.find_subsets(query);
+    std::sort(results.begin(), results.end());
+    std::vector<std::uint64_t> expected = {big, big + 1};
+    EXPECT_EQ(results, expected);
+
+    EXPECT_TRUE(searcher.remove(big));
+    EXPECT_EQ(searcher.find_subsets(binary_set(6, true)).size(), 2u);
+}
+
+namespace {
+
+// Payload without a std::hash specialization
+struct rule {
+    unsigned int id;
+    int priority;
+
+    bool operator==(const rule &) const = default;
+};
+
+// Payload without a default constructor
+struct label {
+    explicit label(unsigned int id) : id(id) {}
+
+    unsigned int id;
+
+    bool operator==(const label &) const = default;
+};
+
+}  // namespace
+
+TEST(BSSearcherTest, StructPayload) {
+    basic_bs_searcher<rule> searcher(4);
+
+    binary_set a(4);
+    a.add(0);
+    binary_set b(4);
+    b.add(0);
+    b.add(3);
+    searcher.add({1, 10}, a);
+    searcher.add({2, 20}, a);
+    searcher.add({3, 30}, b);
+
+    binary_set query(4, true);
+    std::vector<std::span<const rule>> spans = searcher.find_subset_spans(query);
+    std::size_t total = 0;
+    for (const auto &span : spans) total += span.size();
+    EXPECT_EQ(spans.size(), 2u);
+    EXPECT_EQ(total, 3u);
+
+    EXPECT_TRUE(searcher.remove({2, 20}, a));
+    EXPECT_FALSE(searcher.remove({2, 20}, a));
+    std::vector<rule> results = searcher.find_subsets(a);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0], (rule{1, 10}));
+
+    searcher.observe_query(query);
+    searcher.rebuild();
+    EXPECT_EQ(searcher.find_subsets(query).size(), 2u);
+
+    EXPECT_THROW(basic_bs_searcher<rule>(4, basic_bs_searcher<rule>::insert_mode::plain, true), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, NonDefaultConstructiblePayload) {
+    basic_bs_searcher<label> searcher(4);
+
+    binary_set a(4);
+    a.add(0);
+    binary_set b(4);
+    b.add(0);
+    b.add(3);
+    for (unsigned int id = 0; id < 5; ++id) searcher.add(label(id), a);
+    searcher.add(label(5), b);
+    EXPECT_EQ(searcher.find_subsets(a).size(), 5u);
+    EXPECT_EQ(searcher.find_subsets(b, 2, 2), std::vector<label>{label(5)});
+
+    EXPECT_TRUE(searcher.remove(label(2), a));
+    const basic_bs_searcher<label> extracted = searcher.extract_if([](const label &value, const binary_set &) { return value.id == 5; });
+    EXPECT_EQ(extracted.find_subsets(b), std::vector<label>{label(5)});
+    EXPECT_EQ(searcher.find_subsets(b).size(), 4u);
+
+    basic_bs_searcher<label> loaded(4);
+    loaded.bulk_load(std::vector<std::pair<label, binary_set>>{{label(6), b}});
+    searcher.merge(std::move(loaded));
+    searcher.rebuild();
+    EXPECT_EQ(searcher.find_subsets(b).size(), 5u);
+}
+
+TEST(BSSearcherTest, FindSubsetSpans) {
+    bs_searcher searcher(3);
+    binary_set a(3);
+    a.add(1);
+    searcher.add(7, a);
+    searcher.add(8, a);
+
+    std::vector<std::span<const unsigned int>> spans = searcher.find_subset_spans(binary_set(3, true));
+    ASSERT_EQ(spans.size(), 1u);
+    std::vector<unsigned int> values(spans[0].begin(), spans[0].end());
+    std::vector<unsigned int> expected = {7, 8};
+    EXPECT_EQ(values, expected);
+    EXPECT_TRUE(searcher.find_subset_spans(binary_set(3)).empty());
+}
+
+TEST(BSSearcherTest, FindSubsetsBySize) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(13);
+    std::bernoulli_distribution stored_bit(0.06);
+    std::bernoulli_distribution query_bit(0.7);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+    for (unsigned int id = 0; id < 300; id += 3) {
+        EXPECT_TRUE(searcher.remove(id, stored[id]));  // Summaries must shrink back
+    }
+
+    for (int q = 0; q < 30; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+
+        for (auto [min_size, max_size] : {std::pair{0u, 70u}, std::pair{3u, 70u}, std::pair{2u, 2u}, std::pair{0u, 1u}, std::pair{4u, 3u}}) {
+            std::vector<unsigned int> expected;
+            for (unsigned int id = 0; id < 300; ++id) {
+                if (id % 3 != 0 && query.contains(stored[id]) && stored[id].size() >= min_size && stored[id].size() <= max_size) expected.push_back(id);
+            }
+            std::vector<unsigned int> results = searcher.find_subsets(query, min_size, max_size);
+            std::sort(results.begin(), results.end());
+            EXPECT_EQ(results, expected) << "sizes " << min_size << ".." << max_size;
+        }
+    }
+}
+
+TEST(BSSearcherTest, FindNearSubsets) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(17);
+    std::bernoulli_distribution stored_bit(0.08);
+    std::bernoulli_distribution query_bit(0.6);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+
+    for (int q = 0; q < 30; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+
+        for (unsigned int k : {0u, 1u, 3u}) {
+            std::vector<unsigned int> expected;
+            for (unsigned int id = 0; id < 300; ++id) {
+                if ((stored[id] - query).size() <= k) expected.push_back(id);
+            }
+            std::vector<unsigned int> results = searcher.find_near_subsets(query, k);
+            std::sort(results.begin(), results.end());
+            EXPECT_EQ(results, expected) << "k = " << k;
+        }
+    }
+
+    // A budget as large as the capacity admits every stored set
+    EXPECT_EQ(searcher.find_near_subsets(binary_set(capacity), capacity).size(), 300u);
+}
+
+TEST(BSSearcherTest, FindOverlapping) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(19);
+    std::bernoulli_distribution stored_bit(0.1);
+    std::bernoulli_distribution query_bit(0.1);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+
+    for (int q = 0; q < 30; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+
+        std::vector<unsigned int> expected;
+        for (unsigned int id = 0; id < 300; ++id) {
+            if (stored[id].intersects(query)) expected.push_back(id);
+        }
+        std::vector<unsigned int> results = searcher.find_intersecting(query);
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+
+        for (unsigned int t : {0u, 2u, 3u}) {
+            expected.clear();
+            for (unsigned int id = 0; id < 300; ++id) {
+                if ((stored[id] & query).size() >= t) expected.push_back(id);
+            }
+            results = searcher.find_overlapping(query, t);
+            std::sort(results.begin(), results.end());
+            EXPECT_EQ(results, expected) << "t = " << t;
+        }
+    }
+
+    EXPECT_TRUE(searcher.find_intersecting(binary_set(capacity)).empty());
+    EXPECT_TRUE(bs_searcher(capacity).find_overlapping(binary_set(capacity), 0).empty());
+}
+
+TEST(BSSearcherTest, FindExactAndBetween) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(23);
+    std::bernoulli_distribution stored_bit(0.05);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+    searcher.add(300, stored[7]);
+
+    std::vector<unsigned int> expected = {7, 300};
+    std::vector<unsigned int> results = searcher.find_exact(stored[7]);
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(results, expected);
+    binary_set missing(capacity, true);
+    EXPECT_TRUE(searcher.find_exact(missing).empty());
+
+    std::bernoulli_distribution lower_bit(0.02);
+    std::bernoulli_distribution upper_bit(0.7);
+    for (int q = 0; q < 30; ++q) {
+        binary_set lower(capacity);
+        binary_set upper(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (upper_bit(gen)) upper.add(i);
+            if (lower_bit(gen)) lower.add(i);
+        }
+        lower = lower & upper;
+
+        expected.clear();
+        for (unsigned int id = 0; id < 300; ++id) {
+            if (stored[id].contains(lower) && upper.contains(stored[id])) expected.push_back(id);
+        }
+        if (stored[7].contains(lower) && upper.contains(stored[7])) expected.push_back(300);
+        results = searcher.find_between(lower, upper);
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+    }
+
+    // A lower bound outside the upper bound admits nothing
+    binary_set lower(capacity);
+    lower.add(3);
+    EXPECT_TRUE(searcher.find_between(lower, binary_set(capacity)).empty());
+    EXPECT_THROW(searcher.find_between(lower, binary_set(5)), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, FindMatching) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(29);
+    std::bernoulli_distribution stored_bit(0.3);
+    std::bernoulli_distribution care_bit(0.05);
+    std::bernoulli_distribution value_bit(0.5);
+
+    bs_searcher searcher(capacity);
+    std::vector<binary_set> stored;
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        stored.push_back(bs);
+    }
+
+    for (int q = 0; q < 30; ++q) {
+        binary_set care(capacity);
+        binary_set value(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (care_bit(gen)) care.add(i);
+            if (value_bit(gen)) value.add(i);  // Also outside care, where it is ignored
+        }
+
+        std::vector<unsigned int> expected;
+        for (unsigned int id = 0; id < 300; ++id) {
+            if ((stored[id] & care) == (value & care)) expected.push_back(id);
+        }
+        std::vector<unsigned int> results = searcher.find_matching(care, value);
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+    }
+
+    // No cared element: every stored set matches
+    EXPECT_EQ(searcher.find_matching(binary_set(capacity), binary_set(capacity)).size(), 300u);
+}
+
+TEST(BSSearcherTest, FindSubsetsBitmap) {
+    const unsigned int capacity = 10;
+    std::mt19937 gen(31);
+    std::bernoulli_distribution bit(0.3);
+    bs_searcher searcher(capacity);
+    for (unsigned int id = 0; id < 200; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+    }
+
+    binary_set query(capacity);
+    for (unsigned int i = 0; i < capacity; i += 2) query.add(i);
+    binary_set matches(200);
+    searcher.find_subsets_bitmap(query, matches);
+    std::vector<unsigned int> expected = searcher.find_subsets(query);
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(matches.sparse(), expected);
+
+    // Marks accumulate, so results combine like any other bitmap
+    binary_set even(200);
+    for (unsigned int id = 0; id < 200; id += 2) even.add(id);
+    even &= matches;
+    binary_set other(capacity);
+    other.add(1);
+    searcher.find_subsets_bitmap(other, matches);
+    std::vector<unsigned int> either = searcher.find_subsets(other);
+    either.insert(either.end(), expected.begin(), expected.end());
+    std::sort(either.begin(), either.end());
+    either.erase(std::unique(either.begin(), either.end()), either.end());
+    EXPECT_EQ(matches.sparse(), either);
+    for (unsigned int id : even) EXPECT_TRUE(id % 2 == 0 && std::binary_search(expected.begin(), expected.end(), id));
+
+    binary_set small(100);
+    EXPECT_THROW(searcher.find_subsets_bitmap(query, small), std::out_of_range);
+    EXPECT_THROW(searcher.find_subsets_bitmap(binary_set(4), matches), std::invalid_argument);
+}
+
+TEST(BSSearcherTest, AllOnesSuffixShortcut) {
+    const unsigned int capacity = 70;  // Keys span two words
+    std::mt19937 gen(37);
+    std::bernoulli_distribution stored_bit(0.2);
+    std::bernoulli_distribution query_bit(0.7);
+
+    std::vector<std::pair<unsigned int, binary_set>> entries;
+    for (unsigned int id = 0; id < 400; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        entries.emplace_back(id, bs);
+    }
+
+    // Random prefixes of growing length, followed by every remaining element
+    std::vector<binary_set> queries = {binary_set(capacity), binary_set(capacity, true)};
+    for (unsigned int prefix = 0; prefix <= capacity; prefix += 5) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (i >= prefix || query_bit(gen)) query.add(i);
+        }
+        queries.push_back(query);
+    }
+
+    auto check = [&](const bs_searcher &searcher, const std::vector<std::pair<unsigned int, binary_set>> &stored) {
+        for (const binary_set &query : queries) {
+            std::vector<unsigned int> expected;
+            for (const auto &[id, bs] : stored) {
+                if (query.contains(bs)) expected.push_back(id);
+            }
+            std::sort(expected.begin(), expected.end());
+            std::vector<unsigned int> results = searcher.find_subsets(query);
+            std::sort(results.begin(), results.end());
+            EXPECT_EQ(results, expected);
+
+            binary_set matches(1000);
+            searcher.find_subsets_bitmap(query, matches);
+            EXPECT_EQ(matches.sparse(), expected);
+        }
+    };
+
+    // Bulk loaded: the value pool is in depth-first order
+    bs_searcher searcher(capacity, bs_searcher::insert_mode::plain, true);
+    searcher.bulk_load(entries);
+    check(searcher, entries);
+
+    // Adds and removals move leaf ranges out of order
+    for (unsigned int id = 400; id < 500; ++id) {
+        searcher.add(id, entries[id % 400].second);
+        entries.emplace_back(id, entries[id % 400].second);
+    }
+    for (unsigned int id = 0; id < 400; id += 3) EXPECT_TRUE(searcher.remove(id));
+    std::erase_if(entries, [](const auto &entry) { return entry.first < 400 && entry.first % 3 == 0; });
+    check(searcher, entries);
+
+    // Rebuilding restores the order, under a new element order
+    searcher.rebuild();
+    check(searcher, entries);
+}
+
+TEST(BSSearcherTest, ValuePoolCompaction) {
+    const unsigned int capacity = 12;
+    bs_searcher searcher(capacity, bs_searcher::insert_mode::plain, true);
+
+    // Interleaved adds keep moving the leaf ranges to the end of the pool
+    std::vector<binary_set> sets;
+    for (unsigned int s = 0; s < 40; ++s) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if ((s * 7 + i * 3) % 5 == 0) bs.add(i);
+        }
+        sets.push_back(bs);
+    }
+    for (unsigned int id = 0; id < 2000; ++id) searcher.add(id, sets[id % 40]);
+    const std::size_t full_usage = searcher.memory_usage();
+
+    // Removing most values, through both removal paths, triggers compactions
+    for (unsigned int id = 0; id < 2000; ++id) {
+        if (id % 10 == 0) continue;
+        if (id % 2 == 0) {
+            EXPECT_TRUE(searcher.remove(id));
+        } else {
+            EXPECT_TRUE(searcher.remove(id, sets[id % 40]));
+        }
+    }
+    for (unsigned int id = 2000; id < 2040; ++id) searcher.add(id, sets[id % 40]);
+    EXPECT_LT(searcher.memory_usage(), full_usage);
+
+    std::vector<unsigned int> expected;
+    for (unsigned int id = 0; id < 2000; id += 10) expected.push_back(id);
+    for (unsigned int id = 2000; id < 2040; ++id) expected.push_back(id);
+    std::vector<unsigned int> results = searcher.find_subsets(binary_set(capacity, true));
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(results, expected);
+
+    for (unsigned int id : expected) EXPECT_TRUE(searcher.remove(id));
+    EXPECT_TRUE(searcher.find_subsets(binary_set(capacity, true)).empty());
+}
+
+TEST(BSSearcherTest, QueryCache) {
+    bs_searcher searcher(6, bs_searcher::insert_mode::plain, true);
+    searcher.set_cache_capacity(2);
+
+    binary_set a(6);
+    a.add(1);
+    binary_set b(6);
+    b.add(1);
+    b.add(4);
+    searcher.add(1, a);
+    searcher.add(2, b);
+
+    binary_set q1(6);
+    q1.add(1);
+    binary_set q2(6);
+    q2.add(1);
+    q2.add(2);
+    std::vector<unsigned int> expected = {1};
+    EXPECT_EQ(searcher.find_subsets(q1), expected);
+    EXPECT_EQ(searcher.find_subsets(q1), expected);
+    EXPECT_EQ(searcher.find_subsets(q2), expected);
+    EXPECT_EQ(searcher.cache_hits(), 1u);
+    EXPECT_EQ(searcher.cache_misses(), 2u);
+
+    // Adding {1, 2} only invalidates q2, which contains it
+    binary_set c(6);
+    c.add(1);
+    c.add(2);
+    searcher.add(3, c);
+    EXPECT_EQ(searcher.find_subsets(q1), expected);
+    expected = {1, 3};
+    std::vector<unsigned int> results = searcher.find_subsets(q2);
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(results, expected);
+    EXPECT_EQ(searcher.cache_hits(), 2u);
+    EXPECT_EQ(searcher.cache_misses(), 3u);
+
+    // Removals, with or without the set, drop the value from cached results
+    EXPECT_TRUE(searcher.remove(1, a));
+    expected = {3};
+    EXPECT_EQ(searcher.find_subsets(q2), expected);
+    EXPECT_TRUE(searcher.remove(3));
+    EXPECT_TRUE(searcher.find_subsets(q2).empty());
+    EXPECT_TRUE(searcher.find_subsets(q1).empty());
+    EXPECT_EQ(searcher.cache_hits(), 5u);
+
+    // A third query evicts q1, both cached entries having been hit since
+    // the hand last passed; q2 is then hit again and survives q1's return
+    binary_set full(6, true);
+    expected = {2};
+    EXPECT_EQ(searcher.find_subsets(full), expected);
+    EXPECT_TRUE(searcher.find_subsets(q2).empty());
+    EXPECT_TRUE(searcher.find_subsets(q1).empty());
+    EXPECT_EQ(searcher.cache_hits(), 6u);
+    EXPECT_EQ(searcher.cache_misses(), 5u);
+
+    // Copies carry the cache, clear() empties it
+    bs_searcher copy = searcher;
+    EXPECT_TRUE(copy.find_subsets(q2).empty());
+    EXPECT_EQ(copy.cache_hits(), searcher.cache_hits() + 1);
+    searcher.clear();
+    EXPECT_TRUE(searcher.find_subsets(full).empty());
+
+    searcher.set_cache_capacity(0);
+    EXPECT_EQ(searcher.cache_hits(), 0u);
+    EXPECT_TRUE(searcher.find_subsets(full).empty());
+    EXPECT_EQ(searcher.cache_misses(), 0u);
+}
+
+TEST(BSSearcherTest, LiveQuery) {
+    const unsigned int capacity = 70;
+    std::mt19937 gen(31);
+    std::bernoulli_distribution stored_bit(0.05);
+    std::uniform_int_distribution<unsigned int> element(0, capacity - 1);
+
+    bs_searcher searcher(capacity);
+    for (unsigned int id = 0; id < 300; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+    }
+
+    auto sorted = [](std::vector<unsigned int> values) {
+        std::sort(values.begin(), values.end());
+        return values;
+    };
+
+    bs_searcher::live_query live(searcher, binary_set(capacity));
+    for (int step = 0; step < 200; ++step) {
+        const unsigned int e = element(gen);
+        if (step % 3 == 2) {
+            live.remove_element(e);
+        } else {
+            live.add_element(e);
+        }
+        ASSERT_EQ(sorted(live.results()), sorted(searcher.find_subsets(live.query()))) << "step " << step;
+
+        // Changing the searcher makes the live query start over
+        if (step % 50 == 0) {
+            binary_set bs(capacity);
+            bs.add(e);
+            searcher.add(1000 + step, bs);
+            EXPECT_EQ(sorted(live.results()), sorted(searcher.find_subsets(live.query())));
+        }
+    }
+
+    live.add_element(0);
+    EXPECT_FALSE(live.add_element(0));
+    EXPECT_TRUE(live.remove_element(0));
+    EXPECT_FALSE(live.remove_element(0));
+    EXPECT_THROW(bs_searcher::live_query(searcher, binary_set(5)), std::invalid_argument);
+}
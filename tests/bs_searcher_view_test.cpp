@@ -0,0 +1,174 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../binary_set.hxx"
+#include "gtest/gtest.h"
+
+namespace {
+
+// Returns a snapshot path unique to the running test
+std::string snapshot_path() {
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    return (std::filesystem::temp_directory_path() / (std::string("bs_") + info->name() + ".snap")).string();
+}
+
+}  // namespace
+
+TEST(BSSearcherViewTest, SaveAndFind) {
+    bs_searcher searcher(8);
+
+    binary_set bs1(8);
+    bs1.add(1);
+    bs1.add(3);
+    searcher.add(101, bs1);
+
+    binary_set bs2(8);
+    bs2.add(1);
+    searcher.add(102, bs2);
+
+    binary_set bs3(8);
+    bs3.add(1);
+    bs3.add(3);
+    bs3.add(5);
+    searcher.add(103, bs3);
+
+    const std::string path = snapshot_path();
+    searcher.save(path);
+
+    bs_searcher_view view(path);
+    EXPECT_EQ(view.capacity(), 8);
+    EXPECT_EQ(view.size(), 3);
+
+    binary_set query(8);
+    query.add(1);
+    query.add(3);
+    query.add(4);
+    query.add(6);
+
+    std::vector<unsigned int> results = view.find_subsets(query);
+    std::sort(results.begin(), results.end());
+    std::vector<unsigned int> expected = {101, 102};
+    EXPECT_EQ(results, expected);
+
+    binary_set bad(10);
+    EXPECT_THROW((void)view.find_subsets(bad), std::invalid_argument);
+
+    std::filesystem::remove(path);
+}
+
+TEST(BSSearcherViewTest, EmptySearcher) {
+    bs_searcher searcher(4);
+    const std::string path = snapshot_path();
+    searcher.save(path);
+
+    bs_searcher_view view(path);
+    EXPECT_EQ(view.size(), 0);
+    EXPECT_TRUE(view.find_subsets(binary_set(4, true)).empty());
+
+    std::filesystem::remove(path);
+}
+
+TEST(BSSearcherViewTest, MatchesSearcherAfterRebuild) {
+    const unsigned int capacity = 40;
+    std::mt19937 gen(3);
+    std::bernoulli_distribution stored_bit(0.15);
+    std::bernoulli_distribution query_bit(0.7);
+
+    bs_searcher searcher(capacity);
+    for (unsigned int id = 0; id < 500; ++id) {
+        binary_set bs(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (stored_bit(gen)) bs.add(i);
+        }
+        searcher.add(id, bs);
+        searcher.add(id + 1000, bs);  // Leaves holding several values
+    }
+    searcher.rebuild();  // The snapshot must carry the element order
+
+    const std::string path = snapshot_path();
+    searcher.save(path);
+    bs_searcher_view opened(path);
+    bs_searcher_view view(std::move(opened));
+
+    for (int q = 0; q < 50; ++q) {
+        binary_set query(capacity);
+        for (unsigned int i = 0; i < capacity; ++i) {
+            if (query_bit(gen)) query.add(i);
+        }
+        std::vector<unsigned int> expected = searcher.find_subsets(query);
+        std::vector<unsigned int> results = view.find_subsets(query);
+        std::sort(expected.begin(), expected.end());
+        std::sort(results.begin(), results.end());
+        EXPECT_EQ(results, expected);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(BSSearcherViewTest, InvalidFiles) {
+    EXPECT_THROW(bs_searcher_view("/nonexistent/dir/file.snap"), std::runtime_error);
+
+    const std::string path = snapshot_path();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "definitely not a snapshot file";
+    }
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+
+    // A valid snapshot with its tail cut off
+    bs_searcher searcher(4);
+    searcher.add(1, binary_set(4, true));
+    searcher.save(path);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+TEST(BSSearcherViewTest, CorruptedContents) {
+    bs_searcher searcher(4);
+    binary_set a(4);
+    a.add(1);
+    searcher.add(1, a);
+    searcher.add(2, binary_set(4, true));
+
+    const std::string path = snapshot_path();
+    searcher.save(path);
+    std::vector<char> original(std::filesystem::file_size(path));
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(original.data(), static_cast<std::streamsize>(original.size()));
+    }
+
+    // Layout for capacity 4: 32-byte header, order at 32, 32-byte nodes from 48
+    auto corrupt = [&](std::size_t offset, auto value) {
+        std::vector<char> bytes = original;
+        std::memcpy(bytes.data() + offset, &value, sizeof value);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    };
+    constexpr std::size_t order = 32, root = 48, left = 16, right = 20, values_begin = 8, value_count = 28;
+
+    corrupt(order, std::uint32_t{4});  // Element out of range
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+    corrupt(order, std::uint32_t{1});  // Element tested twice
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+    corrupt(root + left, std::uint32_t{1000});  // Child past the node array
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+    corrupt(root + 32 + right, std::uint32_t{1});  // Node linked to itself
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+    corrupt(root + values_begin, std::uint64_t{1} << 40);  // Range past the values
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+    corrupt(root + value_count, std::uint32_t{3});
+    EXPECT_THROW(bs_searcher_view{path}, std::runtime_error);
+
+    corrupt(0, original[0]);  // Unchanged
+    EXPECT_EQ(bs_searcher_view(path).size(), 2u);
+
+    std::filesystem::remove(path);
+}
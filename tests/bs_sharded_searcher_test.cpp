@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../binary_set.hxx"
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<unsigned int> sorted(std::vector<unsigned int> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+}  // namespace
+
+TEST(BSShardedSearcherTest, Constructor) {
+    bs_sharded_searcher searcher(10, 3);
+    EXPECT_EQ(searcher.shard_count(), 8u);
+    EXPECT_EQ(searcher.prefix_bits(), 3u);
+    EXPECT_TRUE(searcher.find_subsets(binary_set(10)).empty());
+
+    bs_sharded_searcher unsharded(10, 0);
+    EXPECT_EQ(unsharded.shard_count(), 1u);
+
+    EXPECT_THROW(bs_sharded_searcher(4, 5), std::invalid_argument);
+    EXPECT_THROW(bs_sharded_searcher(64, bs_sharded_searcher::max_prefix_bits + 1), std::invalid_argument);
+    EXPECT_THROW((void)searcher.find_subsets(binary_set(8)), std::invalid_argument);
+    EXPECT_THROW((void)searcher.shard_searcher(8), std::out_of_range);
+}
+
+TEST(BSShardedSearcherTest, AddFindRemove) {
+    bs_sharded_searcher searcher(8, 2);
+
+    binary_set bs1(8);
+    bs1.add(1);
+    bs1.add(3);
+    searcher.add(101, bs1);
+
+    binary_set bs2(8);
+    bs2.add(0);
+    bs2.add(5);
+    searcher.add(102, bs2);
+
+    binary_set bs3(8);
+    bs3.add(6);
+    searcher.add(103, bs3);
+
+    // Each set went to the shard of its first two elements
+    EXPECT_EQ(searcher.shard_searcher(0b10).find_subsets(bs1), std::vector<unsigned int>{101});
+    EXPECT_EQ(searcher.shard_searcher(0b01).find_subsets(bs2), std::vector<unsigned int>{102});
+    EXPECT_EQ(searcher.shard_searcher(0b00).find_subsets(bs3), std::vector<unsigned int>{103});
+
+    binary_set query(8);
+    query.add(1);
+    query.add(3);
+    query.add(6);
+    EXPECT_EQ(sorted(searcher.find_subsets(query)), (std::vector<unsigned int>{101, 103}));
+
+    EXPECT_TRUE(searcher.remove(101, bs1));
+    EXPECT_FALSE(searcher.remove(101, bs1));
+    EXPECT_EQ(searcher.find_subsets(query), std::vector<unsigned int>{103});
+
+    searcher.clear();
+    EXPECT_TRUE(searcher.find_subsets(binary_set(8)).empty());
+    query.add(0);
+    query.add(5);
+    EXPECT_TRUE(searcher.find_subsets(query).empty());
+}
+
+TEST(BSShardedSearcherTest, MatchesSingleSearcher) {
+    constexpr unsigned int capacity = 24;
+    std::mt19937 gen(5);
+    std::bernoulli_distribution stored_bit(0.2);
+    std::bernoulli_distribution query_bit(0.7);
+    bs_searcher single(capacity);
+    bs_sharded_searcher sharded(capacity, 4);
+
+    std::vector<binary_set> stored;
+    for (unsigned int i = 0; i < 500; ++i) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (stored_bit(gen)) bs.add(e);
+        }
+        stored.push_back(bs);
+        single.add(i, stored.back());
+        sharded.add(i, stored.back());
+    }
+    for (unsigned int i = 0; i < 500; i += 3) {
+        ASSERT_TRUE(single.remove(i, stored[i]));
+        ASSERT_TRUE(sharded.remove(i, stored[i]));
+    }
+
+    for (int q = 0; q < 50; ++q) {
+        binary_set query(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (query_bit(gen)) query.add(e);
+        }
+        const std::vector<unsigned int> expected = sorted(single.find_subsets(query));
+        EXPECT_EQ(sorted(sharded.find_subsets(query)), expected);
+        EXPECT_EQ(sorted(sharded.find_subsets(query, 3)), expected);
+        EXPECT_EQ(sorted(sharded.find_subsets(query, 0)), expected);
+    }
+
+    EXPECT_GT(sharded.memory_usage(), single.memory_usage());
+}
+
+TEST(BSShardedSearcherTest, ThreadedQueriesOnLargeShards) {
+    // Enough values for extra query threads: 40000 / values_per_query_thread + 1 = 3
+    static_assert(40000 / bs_sharded_searcher::values_per_query_thread + 1 == 3);
+    constexpr unsigned int capacity = 16;
+    bs_sharded_searcher searcher(capacity, 2);
+    for (unsigned int i = 0; i < 40000; ++i) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if ((i >> e) & 1u) bs.add(e);
+        }
+        searcher.add(i, bs);
+    }
+
+    binary_set query(capacity);
+    for (unsigned int e = 0; e < capacity; e += 3) query.add(e);
+    query.add(1);
+    const std::vector<unsigned int> expected = sorted(searcher.find_subsets(query));
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(sorted(searcher.find_subsets(query, 4)), expected);
+
+    for (unsigned int i = 0; i < 40000; i += 2) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if ((i >> e) & 1u) bs.add(e);
+        }
+        ASSERT_TRUE(searcher.remove(i, bs));
+    }
+    std::vector<unsigned int> odd;
+    for (unsigned int value : expected) {
+        if (value % 2 == 1) odd.push_back(value);
+    }
+    EXPECT_EQ(sorted(searcher.find_subsets(query, 4)), odd);
+}
+
+TEST(BSShardedSearcherTest, ConcurrentAddsAndQueries) {
+    constexpr unsigned int capacity = 16;
+    bs_sharded_searcher searcher(capacity, 3);
+    std::vector<std::vector<binary_set>> batches(4);
+    std::mt19937 gen(9);
+    std::bernoulli_distribution bit(0.3);
+    for (auto& batch : batches) {
+        for (int i = 0; i < 200; ++i) {
+            binary_set bs(capacity);
+            for (unsigned int e = 0; e < capacity; ++e) {
+                if (bit(gen)) bs.add(e);
+            }
+            batch.push_back(bs);
+        }
+    }
+
+    std::vector<std::thread> writers;
+    for (unsigned int t = 0; t < batches.size(); ++t) {
+        writers.emplace_back([&searcher, &batches, t] {
+            for (unsigned int i = 0; i < batches[t].size(); ++i) searcher.add(t * 1000 + i, batches[t][i]);
+        });
+    }
+    const binary_set full(capacity, true);
+    std::thread reader([&searcher, &full] {
+        for (int i = 0; i < 50; ++i) (void)searcher.find_subsets(full, 2);
+    });
+    for (std::thread& writer : writers) writer.join();
+    reader.join();
+
+    EXPECT_EQ(searcher.find_subsets(full).size(), 800u);
+}
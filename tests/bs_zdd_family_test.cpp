@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../binary_set.hxx"
+#include "gtest/gtest.h"
+
+namespace {
+
+std::set<std::string> as_strings(const std::vector<binary_set>& sets) {
+    std::set<std::string> strings;
+    for (const binary_set& bs : sets) strings.insert(static_cast<std::string>(bs));
+    return strings;
+}
+
+}  // namespace
+
+TEST(BSZddFamilyTest, Constructor) {
+    bs_zdd_family family(10);
+    EXPECT_TRUE(family.empty());
+    EXPECT_EQ(family.count(), 0u);
+    EXPECT_EQ(family.capacity(), 10u);
+    EXPECT_TRUE(family.find_subsets(binary_set(10, true)).empty());
+    EXPECT_THROW((void)family.contains(binary_set(8)), std::invalid_argument);
+    EXPECT_THROW(family |= bs_zdd_family(8), std::invalid_argument);
+}
+
+TEST(BSZddFamilyTest, AddRemoveContains) {
+    bs_zdd_family family(8);
+
+    binary_set bs1(8);
+    bs1.add(1);
+    bs1.add(3);
+    binary_set bs2(8);
+    bs2.add(1);
+    binary_set empty(8);
+
+    EXPECT_TRUE(family.add(bs1));
+    EXPECT_FALSE(family.add(bs1));
+    EXPECT_TRUE(family.add(bs2));
+    EXPECT_TRUE(family.add(empty));
+    EXPECT_EQ(family.count(), 3u);
+
+    EXPECT_TRUE(family.contains(bs1));
+    EXPECT_TRUE(family.contains(bs2));
+    EXPECT_TRUE(family.contains(empty));
+    binary_set other(8);
+    other.add(3);
+    EXPECT_FALSE(family.contains(other));
+    other.add(1);
+    other.add(7);
+    EXPECT_FALSE(family.contains(other));
+
+    binary_set query(8);
+    query.add(1);
+    query.add(4);
+    EXPECT_EQ(as_strings(family.find_subsets(query)), as_strings({bs2, empty}));
+
+    EXPECT_TRUE(family.remove(bs2));
+    EXPECT_FALSE(family.remove(bs2));
+    EXPECT_FALSE(family.contains(bs2));
+    EXPECT_EQ(family.count(), 2u);
+
+    family.clear();
+    EXPECT_TRUE(family.empty());
+}
+
+TEST(BSZddFamilyTest, SharesEqualSubtrees) {
+    // Every set made of any subset of {0, 1} and any subset of {6, ..., 9}:
+    // all branches below an element lead to the same sub-family
+    bs_zdd_family family(10);
+    for (unsigned int head = 0; head < 4; ++head) {
+        for (unsigned int tail = 0; tail < 16; ++tail) {
+            binary_set bs(10);
+            for (unsigned int i = 0; i < 2; ++i) {
+                if (head >> i & 1u) bs.add(i);
+            }
+            for (unsigned int i = 0; i < 4; ++i) {
+                if (tail >> i & 1u) bs.add(6 + i);
+            }
+            family.add(bs);
+        }
+    }
+    EXPECT_EQ(family.count(), 64u);
+    // One node per element, whose children are equal, and the 1 terminal
+    EXPECT_EQ(family.node_count(), 7u);
+}
+
+TEST(BSZddFamilyTest, MatchesBruteForce) {
+    constexpr unsigned int capacity = 20;
+    std::mt19937 gen(17);
+    std::bernoulli_distribution stored_bit(0.25);
+    std::bernoulli_distribution query_bit(0.6);
+    bs_zdd_family family(capacity);
+    std::set<std::string> expected;
+    std::vector<binary_set> stored;
+
+    for (int i = 0; i < 2000; ++i) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (stored_bit(gen)) bs.add(e);
+        }
+        EXPECT_EQ(family.add(bs), expected.insert(static_cast<std::string>(bs)).second);
+        stored.push_back(bs);
+    }
+    for (std::size_t i = 0; i < stored.size(); i += 2) {
+        EXPECT_EQ(family.remove(stored[i]), expected.erase(static_cast<std::string>(stored[i])) == 1);
+    }
+    EXPECT_EQ(family.count(), expected.size());
+
+    for (int q = 0; q < 30; ++q) {
+        binary_set query(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (query_bit(gen)) query.add(e);
+        }
+        std::set<std::string> subsets;
+        for (const binary_set& bs : stored) {
+            if (query.contains(bs) && expected.count(static_cast<std::string>(bs))) subsets.insert(static_cast<std::string>(bs));
+        }
+        const std::vector<binary_set> found = family.find_subsets(query);
+        EXPECT_EQ(found.size(), subsets.size());
+        EXPECT_EQ(as_strings(found), subsets);
+    }
+}
+
+TEST(BSZddFamilyTest, UnionIntersectionDifference) {
+    constexpr unsigned int capacity = 16;
+    std::mt19937 gen(23);
+    std::bernoulli_distribution bit(0.3);
+    bs_zdd_family a(capacity), b(capacity);
+    std::set<std::string> in_a, in_b;
+    for (int i = 0; i < 300; ++i) {
+        binary_set bs(capacity);
+        for (unsigned int e = 0; e < capacity; ++e) {
+            if (bit(gen)) bs.add(e);
+        }
+        if (i % 3 != 0) {
+            a.add(bs);
+            in_a.insert(static_cast<std::string>(bs));
+        }
+        if (i % 3 != 1) {
+            b.add(bs);
+            in_b.insert(static_cast<std::string>(bs));
+        }
+    }
+
+    std::set<std::string> both, either, only_a;
+    std::set_intersection(in_a.begin(), in_a.end(), in_b.begin(), in_b.end(), std::inserter(both, both.end()));
+    std::set_union(in_a.begin(), in_a.end(), in_b.begin(), in_b.end(), std::inserter(either, either.end()));
+    std::set_difference(in_a.begin(), in_a.end(), in_b.begin(), in_b.end(), std::inserter(only_a, only_a.end()));
+
+    const binary_set full(capacity, true);
+    EXPECT_EQ(as_strings((a | b).find_subsets(full)), either);
+    EXPECT_EQ(as_strings((a & b).find_subsets(full)), both);
+    EXPECT_EQ(as_strings((a - b).find_subsets(full)), only_a);
+    EXPECT_EQ((a | b).count(), either.size());
+
+    bs_zdd_family c = a;
+    c |= c;
+    EXPECT_EQ(c.count(), a.count());
+    c &= c;
+    EXPECT_EQ(c.count(), a.count());
+    c -= c;
+    EXPECT_TRUE(c.empty());
+}
+
+TEST(BSZddFamilyTest, ZeroCapacity) {
+    bs_zdd_family family(0);
+    const binary_set empty;
+    EXPECT_TRUE(family.find_subsets(empty).empty());
+
+    EXPECT_TRUE(family.add(empty));
+    EXPECT_FALSE(family.add(empty));
+    EXPECT_TRUE(family.contains(empty));
+    EXPECT_EQ(family.count(), 1u);
+    EXPECT_EQ(family.find_subsets(empty).size(), 1u);
+    EXPECT_EQ((family | family).count(), 1u);
+
+    EXPECT_TRUE(family.remove(empty));
+    EXPECT_TRUE(family.empty());
+}
+
+TEST(BSZddFamilyTest, DeepDiagram) {
+    // Chains far longer than a call stack could recurse through
+    constexpr unsigned int capacity = 1 << 18;
+    const binary_set full(capacity, true);
+    binary_set even(capacity);
+    for (unsigned int i = 0; i < capacity; i += 2) even.add(i);
+
+    bs_zdd_family a(capacity), b(capacity);
+    a.add(full);
+    a.add(even);
+    b.add(even);
+    EXPECT_EQ(a.count(), 2u);
+    EXPECT_EQ(a.find_subsets(full).size(), 2u);
+    EXPECT_EQ((a | b).count(), 2u);
+    EXPECT_EQ((a & b).count(), 1u);
+    EXPECT_EQ((a - b).count(), 1u);
+    EXPECT_TRUE((a - b).contains(full));
+    EXPECT_TRUE(a.remove(full));
+    EXPECT_EQ(a.count(), 1u);
+}